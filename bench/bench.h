@@ -0,0 +1,22 @@
+/* bench.h - Timing helpers shared by the host benchmarks */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <time.h>
+#include "host.h"
+
+/* Monotonic wall clock in nanoseconds */
+static inline uint64_t now_ns(void) {
+    struct timespec ts;
+    
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+/* Keep the compiler from discarding a computed value */
+static inline void keep(uint64_t v) {
+    __asm__ volatile("" :: "r"(v));
+}
+
+#endif /* BENCH_H */
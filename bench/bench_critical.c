@@ -0,0 +1,81 @@
+/* bench_critical.c - Cost of entering and leaving a critical section */
+
+#include <stdio.h>
+#include "bench.h"
+
+#define ITERS           100000000
+
+static volatile uint32_t shared;
+
+/* A do-nothing replay target: the benchmark never defers an interrupt */
+void bench_replay(void) {
+}
+
+/* ENTER_CRITICAL and LEAVE_CRITICAL as entry.s has them */
+static void soft_masked(void) {
+    int i;
+    
+    for (i = 0; i < ITERS; i++) {
+        __asm__ volatile("incl %0" : "+m"(disable_count) :: "cc");
+        shared++;
+        __asm__ volatile("decl %0\n\t"
+                         "jnz 1f\n\t"
+                         "cmpl $0, %1\n\t"
+                         "je 1f\n\t"
+                         "call bench_replay\n"
+                         "1:"
+                         : "+m"(disable_count) : "m"(irq_pending) : "cc", "memory");
+    }
+}
+
+/* The same through the C entry points, as the scheduler uses them */
+static void soft_calls(void) {
+    int i;
+    
+    for (i = 0; i < ITERS; i++) {
+        enter_critical();
+        shared++;
+        leave_critical();
+    }
+}
+
+/* Saving and restoring EFLAGS, the unprivileged half of a cli/popf
+ * section; cli and sti themselves fault outside ring 0 */
+static void flags_saved(void) {
+    unsigned long flags;
+    int i;
+    
+    for (i = 0; i < ITERS; i++) {
+        __asm__ volatile("pushf\n\tpop %0" : "=r"(flags) :: "memory");
+        shared++;
+        __asm__ volatile("push %0\n\tpopf" :: "r"(flags) : "memory", "cc");
+    }
+}
+
+/* The protected body alone */
+static void bare(void) {
+    int i;
+    
+    for (i = 0; i < ITERS; i++) {
+        shared++;
+        __asm__ volatile("" ::: "memory");
+    }
+}
+
+static double time_ns(void (*fn)(void)) {
+    uint64_t t0 = now_ns();
+    
+    fn();
+    return (double)(now_ns() - t0) / ITERS;
+}
+
+int main(void) {
+    double base = time_ns(bare);
+    
+    printf("ns per critical section around a counter increment (body alone %.2f ns)\n", base);
+    printf("soft mask, inline:          %5.2f\n", time_ns(soft_masked));
+    printf("soft mask, enter/leave():   %5.2f\n", time_ns(soft_calls));
+    printf("pushf/popf:                 %5.2f\n", time_ns(flags_saved));
+    
+    return 0;
+}
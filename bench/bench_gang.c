@@ -0,0 +1,111 @@
+/* bench_gang.c - Barrier loop with and without gang scheduling */
+
+#include <stdio.h>
+#include "host.h"
+
+#define WORKERS         4       /* Threads meeting at the barrier */
+#define WORK            1       /* Ticks each worker computes per round */
+#define RUN_TICKS       100000  /* Simulated ticks per configuration */
+
+static pcb_t *workers[WORKERS];
+static int arrived;
+static uint32_t rounds;
+static uint64_t first_arrival, spread;
+
+static int worker_index(pcb_t *pcb) {
+    int i;
+    
+    for (i = 0; i < WORKERS; i++) {
+        if (workers[i] == pcb) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* The process that ran the last tick did its share of it: a worker that
+ * finished its round waits at the barrier, the last one releases all */
+static void run_tick(pcb_t *cur) {
+    static int worked[WORKERS];
+    int i = worker_index(cur);
+    
+    if (i < 0 || ++worked[i] < WORK) {
+        return;
+    }
+    worked[i] = 0;
+    
+    /* The spread from first to last arrival is what the early ones wait */
+    if (arrived++ == 0) {
+        first_arrival = time_elapsed;
+    }
+    if (arrived < WORKERS) {
+        scheduler_block(PROCESS_BLOCKED);
+        return;
+    }
+    arrived = 0;
+    rounds++;
+    spread += time_elapsed - first_arrival;
+    for (i = 0; i < WORKERS; i++) {
+        if (workers[i]->status == PROCESS_BLOCKED) {
+            scheduler_wakeup(workers[i]);
+        }
+    }
+}
+
+/* Run the barrier loop next to hogs CPU-bound processes */
+static void run(int hogs, int ganged) {
+    pcb_t *cur;
+    int i, gang;
+    uint64_t start;
+    
+    scheduler_init();
+    arrived = 0;
+    rounds = 0;
+    spread = 0;
+    
+    for (i = 0; i < WORKERS; i++) {
+        workers[i] = pcb_allocate();
+        scheduler_add(workers[i]);
+    }
+    for (i = 0; i < hogs; i++) {
+        scheduler_add(pcb_allocate());
+    }
+    if (ganged) {
+        gang = do_gang_create();
+        for (i = 0; i < WORKERS; i++) {
+            do_gang_join(workers[i]->pid, gang);
+        }
+    }
+    scheduler_entry();
+    
+    /* irq0: charge the tick, then switch if a reschedule is due */
+    start = time_elapsed;
+    while (time_elapsed - start < RUN_TICKS) {
+        cur = current_running;
+        time_elapsed++;
+        scheduler_tick();
+        check_sleeping();
+        run_tick(cur);
+        if (current_running->status == PROCESS_RUNNING) {
+            put_current_running();
+            scheduler_entry();
+        }
+    }
+    
+    printf("%-7s %d hogs: %6u rounds, %6.2f ticks/round, arrival spread %6.2f ticks\n",
+           ganged ? "gang" : "no gang", hogs, rounds, (double)RUN_TICKS / rounds,
+           (double)spread / rounds);
+}
+
+int main(void) {
+    int hogs;
+    
+    printf("%d workers, %d tick%s of work per round, %d ticks\n",
+           WORKERS, WORK, WORK == 1 ? "" : "s", RUN_TICKS);
+    for (hogs = 0; hogs <= 8; hogs = hogs ? hogs * 2 : 1) {
+        run(hogs, 0);
+        run(hogs, 1);
+    }
+    
+    return 0;
+}
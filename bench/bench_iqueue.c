@@ -0,0 +1,172 @@
+/* bench_iqueue.c - 16-bit index queues against node_t lists */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "iqueue.h"
+
+#define MAX_ENTRIES     65534   /* Every index below IQ_NONE */
+#define MIN_NS          200000000ull
+#define SWITCHES        1000000
+
+static pcb_t pcbs[MAX_ENTRIES];
+static ilink_t links[MAX_ENTRIES];
+static int order[MAX_ENTRIES];
+static queue_t nq;
+static iqueue_t iq;
+
+/* Queue n objects on both structures in the same shuffled order, as
+ * processes queue independently of their slot */
+static void build(int n) {
+    int i, j, t;
+    
+    for (i = 0; i < n; i++) {
+        order[i] = i;
+        pcbs[i].priority = i & 31;
+    }
+    for (i = n - 1; i > 0; i--) {
+        j = rand() % (i + 1);
+        t = order[i];
+        order[i] = order[j];
+        order[j] = t;
+    }
+    
+    queue_init(&nq);
+    iqueue_init(&iq);
+    for (i = 0; i < n; i++) {
+        queue_put(&nq, &pcbs[order[i]].node);
+        iqueue_put(&iq, links, order[i]);
+    }
+}
+
+/* Look for an object by walking the queue, as queue_contains() does */
+static uint64_t walk_node(int n) {
+    node_t *node, *want = &pcbs[order[n - 1]].node;
+    uint64_t steps = 0;
+    
+    for (node = nq.head; node != want; node = node->next) {
+        steps++;
+    }
+    return steps;
+}
+
+static uint64_t walk_iq(int n) {
+    int i, want = order[n - 1];
+    uint64_t steps = 0;
+    
+    for (i = iq.head; i != want; i = links[i].next) {
+        steps++;
+    }
+    return steps;
+}
+
+/* Round robin: take the head and put it back at the tail, n times */
+static uint64_t rotate_node(int n) {
+    int k;
+    
+    for (k = 0; k < n; k++) {
+        queue_put(&nq, queue_get(&nq));
+    }
+    return (uint64_t)(unsigned long)nq.head;
+}
+
+static uint64_t rotate_iq(int n) {
+    int k;
+    
+    for (k = 0; k < n; k++) {
+        iqueue_put(&iq, links, iqueue_get(&iq, links));
+    }
+    return iq.head;
+}
+
+/* Dequeue a process known to be queued and requeue it, 64 times; both
+ * unlinks are O(1), so this is the cost of touching the neighbours */
+static uint64_t unlink_node(int n) {
+    int k;
+    
+    for (k = 0; k < 64; k++) {
+        queue_unlink(&nq, &pcbs[order[(k * 7919) % n]].node);
+        queue_put(&nq, &pcbs[order[(k * 7919) % n]].node);
+    }
+    return nq.size;
+}
+
+static uint64_t unlink_iq(int n) {
+    int k;
+    
+    for (k = 0; k < 64; k++) {
+        iqueue_unlink(&iq, links, order[(k * 7919) % n]);
+        iqueue_put(&iq, links, order[(k * 7919) % n]);
+    }
+    return iq.size;
+}
+
+/* Nanoseconds per item of one operation, repeated for at least MIN_NS */
+static double per_item(uint64_t (*op)(int), int n, int items) {
+    uint64_t t0 = now_ns(), t, runs = 0;
+    
+    do {
+        keep(op(n));
+        runs++;
+    } while ((t = now_ns() - t0) < MIN_NS);
+    return (double)t / runs / items;
+}
+
+/* Nanoseconds per switch through sim_tick(), and through the
+ * put_current_running() and scheduler_entry() it ends with alone, with
+ * the reschedule the tick would have asked for */
+static void switches(int nr) {
+    uint64_t t0, t_tick, t_entry;
+    int i;
+    
+    scheduler_init();
+    do_sched_setlatency(0);
+    for (i = 0; i < nr; i++) {
+        scheduler_add(pcb_allocate());
+    }
+    scheduler_entry();
+    
+    t0 = now_ns();
+    for (i = 0; i < SWITCHES; i++) {
+        sim_tick();
+    }
+    t_tick = now_ns() - t0;
+    
+    t0 = now_ns();
+    for (i = 0; i < SWITCHES; i++) {
+        cpu_rq(0)->need_resched = 1;
+        put_current_running();
+        scheduler_entry();
+    }
+    t_entry = now_ns() - t0;
+    
+    printf("%8d %14.1f %18.1f\n", nr, (double)t_tick / SWITCHES, (double)t_entry / SWITCHES);
+}
+
+int main(void) {
+    static const int sizes[] = { 64, 1024, 16384, MAX_ENTRIES };
+    int s, n;
+    
+    printf("ns per item: walk (per link followed), rotate (get + put), unlink + put\n");
+    printf("host links: node_t %d bytes, ilink_t %d, pcb_t %d (node_t is 8 bytes on i386,\n"
+           "so node_t walks here touch more memory than the kernel's)\n",
+           (int)sizeof(node_t), (int)sizeof(ilink_t), (int)sizeof(pcb_t));
+    printf("%8s %14s %14s %14s %14s %14s %14s\n", "entries",
+           "walk node_t", "walk iqueue", "rotate node_t", "rotate iqueue",
+           "unlink node_t", "unlink iqueue");
+    for (s = 0; s < (int)(sizeof(sizes) / sizeof(sizes[0])); s++) {
+        n = sizes[s];
+        build(n);
+        printf("%8d %14.2f %14.2f ", n, per_item(walk_node, n, n - 1), per_item(walk_iq, n, n - 1));
+        printf("%14.2f %14.2f ", per_item(rotate_node, n, n), per_item(rotate_iq, n, n));
+        printf("%14.2f %14.2f\n", per_item(unlink_node, n, 64), per_item(unlink_iq, n, 64));
+    }
+    
+    printf("\nscheduler_entry() on iqueue run queues, one-tick quantum, ns per switch\n");
+    printf("%8s %14s %18s\n", "procs", "sim_tick()", "scheduler_entry()");
+    for (n = 2; n <= MAX_PROCESSES; n *= 2) {
+        switches(n);
+    }
+    
+    return 0;
+}
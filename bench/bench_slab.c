@@ -0,0 +1,97 @@
+/* bench_slab.c - Slab cache throughput and fragmentation */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "slab.h"
+
+#define OBJ_SIZE        48      /* About a kevent_t */
+#define PAIRS           (1 << 24)
+#define MAX_LIVE        1500
+#define CHURN           200000
+
+static void *objs[MAX_LIVE];
+
+/* Time rounds of burst allocations followed by as many frees, per pair */
+static void throughput(kmem_cache_t *cache, int burst) {
+    uint64_t t0, t_slab, t_malloc;
+    int r, i, rounds = PAIRS / burst;
+    
+    t0 = now_ns();
+    for (r = 0; r < rounds; r++) {
+        for (i = 0; i < burst; i++) {
+            objs[i] = kmem_cache_alloc(cache);
+        }
+        for (i = burst - 1; i >= 0; i--) {
+            kmem_cache_free(cache, objs[i]);
+        }
+    }
+    t_slab = now_ns() - t0;
+    
+    t0 = now_ns();
+    for (r = 0; r < rounds; r++) {
+        for (i = 0; i < burst; i++) {
+            objs[i] = malloc(OBJ_SIZE);
+            keep((uint64_t)(unsigned long)objs[i]);
+        }
+        for (i = burst - 1; i >= 0; i--) {
+            free(objs[i]);
+        }
+    }
+    t_malloc = now_ns() - t0;
+    
+    printf("burst %4d: slab %5.1f ns/pair, malloc %5.1f ns/pair\n", burst,
+           (double)t_slab / ((uint64_t)rounds * burst),
+           (double)t_malloc / ((uint64_t)rounds * burst));
+}
+
+/* Slabs holding live objects against the fewest that could hold them */
+static void report(kmem_cache_t *cache, const char *phase) {
+    int used = cache->partial.size + cache->full.size;
+    int least = (cache->nr_active + cache->per_slab - 1) / cache->per_slab;
+    
+    printf("%-9s %4u live: %2u slabs (%2d in use, %2d needed), %5.1f%% of used slots live\n",
+           phase, cache->nr_active, cache->nr_slabs, used, least,
+           used ? 100.0 * cache->nr_active / (used * cache->per_slab) : 0.0);
+}
+
+/* Grow to MAX_LIVE, churn at random, then shrink to a tenth at random */
+static void fragmentation(kmem_cache_t *cache) {
+    int live = 0, i, k;
+    
+    srand(1);
+    while (live < MAX_LIVE) {
+        objs[live++] = kmem_cache_alloc(cache);
+    }
+    report(cache, "grown");
+    
+    for (k = 0; k < CHURN; k++) {
+        i = rand() % live;
+        kmem_cache_free(cache, objs[i]);
+        objs[i] = kmem_cache_alloc(cache);
+    }
+    report(cache, "churned");
+    
+    while (live > MAX_LIVE / 10) {
+        i = rand() % live;
+        kmem_cache_free(cache, objs[i]);
+        objs[i] = objs[--live];
+    }
+    report(cache, "shrunk");
+}
+
+int main(void) {
+    static kmem_cache_t hot, frag;
+    int burst;
+    
+    kmem_cache_init(&hot, "bench", OBJ_SIZE, NULL);
+    kmem_cache_init(&frag, "frag", OBJ_SIZE, NULL);
+    
+    printf("%d-byte objects, %d per slab, magazines of %d\n", OBJ_SIZE, hot.per_slab, MAG_SIZE);
+    for (burst = 1; burst <= 1024; burst *= 8) {
+        throughput(&hot, burst);
+    }
+    fragmentation(&frag);
+    
+    return 0;
+}
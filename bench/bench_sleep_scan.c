@@ -0,0 +1,96 @@
+/* bench_sleep_scan.c - Dense sleeper scan against walking a PCB list */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+
+#define MAX_ENTRIES     100000
+#define MIN_NS          200000000ull    /* Time each measurement at least this long */
+
+int sleep_scan_scalar(const uint32_t *wake, int n, uint32_t now, uint32_t *mask);
+int sleep_scan_sse2(const uint32_t *wake, int n, uint32_t now, uint32_t *mask);
+int sleep_scan_avx2(const uint32_t *wake, int n, uint32_t now, uint32_t *mask);
+
+typedef int (*scan_fn)(const uint32_t *, int, uint32_t, uint32_t *);
+
+static uint32_t wake[MAX_ENTRIES];
+static uint32_t mask[(MAX_ENTRIES + 31) / 32];
+
+/* The sleep queue the table replaced: PCBs linked in wakeup order, but
+ * scattered over the process table */
+static pcb_t pcbs[MAX_ENTRIES];
+static node_t *list;
+
+static void build(int n, uint32_t now) {
+    static int order[MAX_ENTRIES];
+    int i, j, t;
+    
+    for (i = 0; i < n; i++) {
+        wake[i] = now + 1 + rand() % 1000;
+        pcbs[i].wakeup_time = wake[i];
+        order[i] = i;
+    }
+    for (i = n - 1; i > 0; i--) {
+        j = rand() % (i + 1);
+        t = order[i];
+        order[i] = order[j];
+        order[j] = t;
+    }
+    for (i = 0; i < n; i++) {
+        pcbs[order[i]].node.next = i + 1 < n ? &pcbs[order[i + 1]].node : NULL;
+    }
+    list = &pcbs[order[0]].node;
+}
+
+/* Each expired PCB found by following the links */
+static int walk(uint32_t now) {
+    node_t *node;
+    int expired = 0;
+    
+    for (node = list; node != NULL; node = node->next) {
+        if (((pcb_t *)node)->wakeup_time <= now) {
+            expired++;
+        }
+    }
+    return expired;
+}
+
+static double time_scan(scan_fn scan, int n, uint32_t now) {
+    uint64_t t0 = now_ns(), t, runs = 0;
+    
+    do {
+        keep(scan(wake, n, now, mask));
+        runs++;
+    } while ((t = now_ns() - t0) < MIN_NS);
+    return (double)t / runs;
+}
+
+static double time_walk(uint32_t now) {
+    uint64_t t0 = now_ns(), t, runs = 0;
+    
+    do {
+        keep(walk(now));
+        runs++;
+    } while ((t = now_ns() - t0) < MIN_NS);
+    return (double)t / runs;
+}
+
+int main(void) {
+    int n, avx2 = __builtin_cpu_supports("avx2");
+    uint32_t now = 1000;
+    
+    printf("%8s %12s %12s %12s %12s  (ns per scan, none expired)\n",
+           "sleepers", "list walk", "scalar", "sse2", "avx2");
+    for (n = 1000; n <= MAX_ENTRIES; n *= 10) {
+        build(n, now);
+        printf("%8d %12.0f %12.0f %12.0f ", n, time_walk(now),
+               time_scan(sleep_scan_scalar, n, now), time_scan(sleep_scan_sse2, n, now));
+        if (avx2) {
+            printf("%12.0f\n", time_scan(sleep_scan_avx2, n, now));
+        } else {
+            printf("%12s\n", "n/a");
+        }
+    }
+    
+    return 0;
+}
@@ -0,0 +1,80 @@
+/* bench_slice.c - Fixed one-tick quantum vs load-sized fair slices */
+
+#include <stdio.h>
+#include "host.h"
+
+#define RUN_TICKS       100000  /* Simulated ticks per configuration */
+#define SLEEP_MS        30      /* The interactive process's think time */
+
+/* Run hogs CPU-bound processes and one that sleeps SLEEP_MS after every
+ * tick it runs, under the given sched_latency (0: fixed quantum) */
+static void run(int hogs, int latency) {
+    pcb_t *inter, *prev;
+    uint64_t start, woken = 0, wait = 0, max_wait = 0;
+    uint32_t switches = 0, wakeups = 0;
+    int i, sleeping = 0;
+    
+    scheduler_init();
+    do_sched_setlatency(latency);
+    
+    inter = pcb_allocate();
+    scheduler_add(inter);
+    for (i = 0; i < hogs; i++) {
+        scheduler_add(pcb_allocate());
+    }
+    scheduler_entry();
+    
+    start = time_elapsed;
+    while (time_elapsed - start < RUN_TICKS) {
+        prev = current_running;
+        time_elapsed++;
+        scheduler_tick();
+        check_sleeping();
+        if (sleeping && inter->status == PROCESS_READY) {
+            sleeping = 0;
+            woken = time_elapsed;
+        }
+        
+        /* The interactive process did its tick of work: back to sleep */
+        if (prev == inter) {
+            inter->nested_count = 1;
+            do_sleep(SLEEP_MS);
+            inter->nested_count = 0;
+            sleeping = 1;
+        }
+        if (current_running->status == PROCESS_RUNNING) {
+            put_current_running();
+            scheduler_entry();
+        }
+        
+        if (current_running != prev) {
+            switches++;
+        }
+        if (current_running == inter && !sleeping && woken != 0) {
+            wait += time_elapsed - woken;
+            if (time_elapsed - woken > max_wait) {
+                max_wait = time_elapsed - woken;
+            }
+            wakeups++;
+            woken = 0;
+        }
+    }
+    
+    printf("latency %2d, %2d hogs: %5.1f switches/100 ticks, wakeup latency mean %5.2f max %3llu ticks\n",
+           latency, hogs, 100.0 * switches / RUN_TICKS,
+           wakeups ? (double)wait / wakeups : 0.0, (unsigned long long)max_wait);
+}
+
+int main(void) {
+    int hogs;
+    
+    printf("%d ticks, think time %d ms; latency 0 is the fixed quantum, %d the default\n",
+           RUN_TICKS, SLEEP_MS, FAIR_TARGET_LATENCY);
+    for (hogs = 1; hogs <= 16; hogs *= 2) {
+        run(hogs, 0);
+        run(hogs, FAIR_TARGET_LATENCY);
+        run(hogs, 4 * FAIR_TARGET_LATENCY);
+    }
+    
+    return 0;
+}
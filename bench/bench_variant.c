@@ -0,0 +1,46 @@
+/* bench_variant.c - Cost of a scheduling round in the build variants */
+
+#include <stdio.h>
+#include "bench.h"
+
+#define TICKS           2000000
+
+/* Nanoseconds per simulated tick with nr fair processes; with sleep the
+ * running one sleeps a tick each time, so every tick also blocks and
+ * wakes a process */
+static double run(int nr, int sleep) {
+    uint64_t t0, t;
+    int i;
+    
+    scheduler_init();
+    do_sched_setlatency(0);
+    for (i = 0; i < nr; i++) {
+        scheduler_add(pcb_allocate());
+    }
+    scheduler_entry();
+    
+    t0 = now_ns();
+    for (i = 0; i < TICKS; i++) {
+        if (sleep) {
+            current_running->nested_count = 1;
+            do_sleep(MS_PER_TICK);
+        }
+        sim_tick();
+    }
+    t = now_ns() - t0;
+    
+    return (double)t / TICKS;
+}
+
+int main(void) {
+    int nr;
+    
+    printf("%s build, ns per tick (tick, pick and switch)\n",
+           CONFIG_SCHED_FAIR_ONLY ? "fair-only, no stats" : "default");
+    for (nr = 2; nr <= 32; nr *= 4) {
+        printf("%2d processes: %6.1f round robin, %6.1f sleeping a tick each\n",
+               nr, run(nr, 0), run(nr, 1));
+    }
+    
+    return 0;
+}
@@ -0,0 +1,159 @@
+/* check_catch_up.c - Closed-form tick catch-up against per-tick replay */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "host.h"
+
+#define TRIALS          200000
+#define MAX_SKIP        400     /* Ticks a stopped tick may skip */
+
+static const int policies[] = { SCHED_NORMAL, SCHED_FIFO, SCHED_RR, SCHED_BATCH, SCHED_IDLE };
+
+/* What the skipped ticks may have changed, as far as it can be seen */
+typedef struct outcome {
+    int slice;
+    int need_resched;
+    int rt_time;
+    int rt_throttled;
+    uint64_t rt_period_start;
+    uint64_t vruntime[3];
+    uint64_t min_vruntime;
+    uint64_t throttled;
+    uint64_t throttled_after;
+} outcome_t;
+
+static pcb_t *p;
+static int run_group, capped_group;
+
+/* One timer tick on a CPU whose tick runs, as scheduler_tick() passes it */
+static void tick(void) {
+    const sched_class_t *class;
+    rq_t *rq = cpu_rq(0);
+    
+    time_elapsed++;
+    for (class = sched_class_highest; class != NULL; class = sched_class_next(class)) {
+        sched_call(class, tick)(rq, pcb_ext(p)->sched_class == class ? p : NULL);
+    }
+}
+
+/* n ticks at once, as tick_nohz_restart() charges them */
+static void catch_up(int n) {
+    const sched_class_t *class;
+    rq_t *rq = cpu_rq(0);
+    uint64_t from = time_elapsed;
+    
+    time_elapsed += n;
+    for (class = sched_class_highest; class != NULL; class = sched_class_next(class)) {
+        sched_call(class, catch_up)(rq, pcb_ext(p)->sched_class == class ? p : NULL,
+                                    from, time_elapsed);
+    }
+}
+
+/* A random state in which the tick may stop: p runs alone, outside any
+ * gang and in an uncapped group; another group has a quota and some of
+ * it used. Returns the number of ticks to skip. */
+static int setup(unsigned seed) {
+    rq_t *rq = cpu_rq(0);
+    pcb_ext_t *ext;
+    int policy, period, i;
+    
+    srand(seed);
+    scheduler_init();
+    time_elapsed = rand() % 1000;
+    
+    p = pcb_allocate();
+    scheduler_add(p);
+    scheduler_entry();
+    p->priority = MIN_PRIORITY + rand() % PRIO_LEVELS;
+    
+    /* Run the capped group through part of a period or a few */
+    period = 1 + rand() % 30;
+    capped_group = do_group_create(1 + rand() % 2048);
+    do_group_setquota(capped_group, rand() % (period + 1), period);
+    do_group_move(p->pid, capped_group);
+    policy = policies[rand() % 5];
+    do_setscheduler(p->pid, policy,
+                    policy == SCHED_FIFO || policy == SCHED_RR ? rand() % RT_PRIO_LEVELS : 0);
+    for (i = rand() % (3 * RT_PERIOD); i > 0; i--) {
+        tick();
+    }
+    
+    run_group = do_group_create(1 + rand() % 2048);
+    do_group_move(p->pid, run_group);
+    
+    ext = pcb_ext(p);
+    rq->fair.slice = 1 + rand() % FAIR_TARGET_LATENCY;
+    ext->slice = policy == SCHED_NORMAL ? rand() % (2 * FAIR_TARGET_LATENCY * FAIR_SLICE_UNIT) :
+                 rand() % (BATCH_TIMESLICE + 1);
+    rq->need_resched = 0;
+    
+    return 1 + rand() % MAX_SKIP;
+}
+
+/* State after the skip, then after running p in the capped group again */
+static void observe(outcome_t *o) {
+    rq_t *rq = cpu_rq(0);
+    int i;
+    
+    o->slice = pcb_ext(p)->slice > 0 ? pcb_ext(p)->slice : 0;
+    o->need_resched = rq->need_resched;
+    o->rt_time = rq->rt.rt_time;
+    o->rt_throttled = rq->rt.throttled;
+    o->rt_period_start = rq->rt.period_start;
+    o->vruntime[0] = rq->fair.groups[ROOT_GROUP].vruntime;
+    o->vruntime[1] = rq->fair.groups[capped_group].vruntime;
+    o->vruntime[2] = rq->fair.groups[run_group].vruntime;
+    o->min_vruntime = rq->fair.min_vruntime;
+    do_group_throttled_time(capped_group, &o->throttled);
+    
+    /* The capped group's runtime and period are only seen through when
+     * it throttles next */
+    do_group_move(p->pid, capped_group);
+    for (i = 0; i < 2 * RT_PERIOD; i++) {
+        tick();
+    }
+    do_group_throttled_time(capped_group, &o->throttled_after);
+}
+
+/* Nonzero if every field matches */
+static int same(const outcome_t *a, const outcome_t *b) {
+    return a->slice == b->slice && a->need_resched == b->need_resched &&
+           a->rt_time == b->rt_time && a->rt_throttled == b->rt_throttled &&
+           a->rt_period_start == b->rt_period_start &&
+           a->vruntime[0] == b->vruntime[0] && a->vruntime[1] == b->vruntime[1] &&
+           a->vruntime[2] == b->vruntime[2] && a->min_vruntime == b->min_vruntime &&
+           a->throttled == b->throttled && a->throttled_after == b->throttled_after;
+}
+
+int main(void) {
+    outcome_t want, got;
+    unsigned seed;
+    int n;
+    
+    for (seed = 1; seed <= TRIALS; seed++) {
+        n = setup(seed);
+        while (n-- > 0) {
+            tick();
+        }
+        observe(&want);
+        
+        catch_up(setup(seed));
+        observe(&got);
+        
+        if (!same(&want, &got)) {
+            printf("seed %u (policy %d): catch_up differs from the ticks it replaces\n",
+                   seed, pcb_ext(p)->policy);
+            printf("  slice %d/%d resched %d/%d rt_time %d/%d rt_throttled %d/%d\n",
+                   want.slice, got.slice, want.need_resched, got.need_resched,
+                   want.rt_time, got.rt_time, want.rt_throttled, got.rt_throttled);
+            printf("  throttled %llu/%llu, after %llu/%llu\n",
+                   (unsigned long long)want.throttled, (unsigned long long)got.throttled,
+                   (unsigned long long)want.throttled_after, (unsigned long long)got.throttled_after);
+            return 1;
+        }
+    }
+    
+    printf("catch_up: matches per-tick replay in %d random states (up to %d ticks)\n",
+           TRIALS, MAX_SKIP);
+    return 0;
+}
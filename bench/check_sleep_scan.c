@@ -0,0 +1,71 @@
+/* check_sleep_scan.c - The sleeper scan kernels against a reference */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "host.h"
+
+#define MAX_ENTRIES     300
+#define TRIALS          20000
+
+/* sleep_scan.c built scalar, with SSE2 and with AVX2 */
+int sleep_scan_scalar(const uint32_t *wake, int n, uint32_t now, uint32_t *mask);
+int sleep_scan_sse2(const uint32_t *wake, int n, uint32_t now, uint32_t *mask);
+int sleep_scan_avx2(const uint32_t *wake, int n, uint32_t now, uint32_t *mask);
+
+typedef int (*scan_fn)(const uint32_t *, int, uint32_t, uint32_t *);
+
+/* Compare one kernel with the plain definition of an expired entry, on
+ * tables spread around now, across the 32-bit wrap and at any length */
+static int check(const char *name, scan_fn scan) {
+    uint32_t wake[MAX_ENTRIES], mask[(MAX_ENTRIES + 31) / 32], want[(MAX_ENTRIES + 31) / 32];
+    uint32_t now;
+    int trial, n, i, count, expired;
+    
+    srand(1);
+    for (trial = 0; trial < TRIALS; trial++) {
+        n = rand() % (MAX_ENTRIES + 1);
+        now = trial & 1 ? (uint32_t)rand() : 0xffffff00u + rand() % 512;
+        for (i = 0; i < n; i++) {
+            wake[i] = now + rand() % 400 - 200;
+        }
+        
+        count = 0;
+        for (i = 0; i < (n + 31) / 32; i++) {
+            want[i] = 0;
+        }
+        for (i = 0; i < n; i++) {
+            if ((int32_t)(now - wake[i]) >= 0) {
+                want[i >> 5] |= (uint32_t)1 << (i & 31);
+                count++;
+            }
+        }
+        
+        expired = scan(wake, n, now, mask);
+        for (i = 0; i < (n + 31) / 32; i++) {
+            if (mask[i] != want[i]) {
+                printf("%s: %d entries, now %u: mask word %d is %08x, want %08x\n",
+                       name, n, now, i, mask[i], want[i]);
+                return 1;
+            }
+        }
+        if (expired != count) {
+            printf("%s: %d entries, now %u: %d expired, want %d\n", name, n, now, expired, count);
+            return 1;
+        }
+    }
+    
+    printf("%s: %d random tables match\n", name, TRIALS);
+    return 0;
+}
+
+int main(void) {
+    int bad = check("scalar", sleep_scan_scalar) | check("sse2", sleep_scan_sse2);
+    
+    if (__builtin_cpu_supports("avx2")) {
+        bad |= check("avx2", sleep_scan_avx2);
+    } else {
+        printf("avx2: not supported by this CPU, skipped\n");
+    }
+    
+    return bad;
+}
@@ -0,0 +1,73 @@
+/* check_ticks.c - Multiply-shift divisions against exact division */
+
+#include <stdio.h>
+#include "host.h"
+
+/* ms_to_ticks() rounds up for every 32-bit input */
+static int check_ms_to_ticks(void) {
+    uint64_t ms;
+    uint32_t want;
+    
+    for (ms = 0; ms <= 0xffffffffu; ms++) {
+        want = (uint32_t)(ms / MS_PER_TICK) + (ms % MS_PER_TICK != 0);
+        if (ms_to_ticks((uint32_t)ms) != want) {
+            printf("ms_to_ticks(%llu) = %u, want %u\n",
+                   (unsigned long long)ms, ms_to_ticks((uint32_t)ms), want);
+            return 1;
+        }
+    }
+    
+    printf("ms_to_ticks: all 2^32 inputs round up exactly (MS_PER_TICK %d)\n", MS_PER_TICK);
+    return 0;
+}
+
+/* The weights step by 2^(1/PRIO_WEIGHT_STEP) from 1 << PRIO_WEIGHT_SHIFT
+ * at DEFAULT_PRIORITY, prio_to_wmult[] holds their rounded-up inverses,
+ * and the tick charge, (FAIR_SLICE_UNIT << PRIO_WEIGHT_SHIFT) * wmult >> 32,
+ * is the exact quotient by the weight at every level */
+static int check_wmult(void) {
+    uint64_t x = (uint64_t)FAIR_SLICE_UNIT << PRIO_WEIGHT_SHIFT, w, want;
+    double step;
+    int l;
+    
+    if (PRIO_WEIGHT(PRIO_LEVEL_DEFAULT) != 1u << PRIO_WEIGHT_SHIFT) {
+        printf("weight at DEFAULT_PRIORITY is %u, want %u\n",
+               PRIO_WEIGHT(PRIO_LEVEL_DEFAULT), 1u << PRIO_WEIGHT_SHIFT);
+        return 1;
+    }
+    
+    for (l = 0; l < PRIO_TABLE_SIZE; l++) {
+        /* 2^(1/8) = 1.0905077; 0.2% covers rounding to 1/1024 above 256 */
+        if (l > 0 && PRIO_WEIGHT(l - 1) >= 256) {
+            step = (double)PRIO_WEIGHT(l) / PRIO_WEIGHT(l - 1);
+            if (step < 1.0905077 * 0.998 || step > 1.0905077 * 1.002) {
+                printf("level %d: weight %u is %.4f times level %d's, want 2^(1/8)\n",
+                       l, PRIO_WEIGHT(l), step, l - 1);
+                return 1;
+            }
+        }
+        
+        w = PRIO_WEIGHT(l);
+        want = ((1ull << PRIO_WMULT_SHIFT) + w - 1) / w;
+        if (prio_to_wmult[l] != want) {
+            printf("level %d (weight %llu): wmult %u, want %llu\n", l,
+                   (unsigned long long)w, prio_to_wmult[l], (unsigned long long)want);
+            return 1;
+        }
+        
+        if ((x * prio_to_wmult[l]) >> PRIO_WMULT_SHIFT != x / w) {
+            printf("level %d (weight %llu): charge %llu, want %llu\n", l,
+                   (unsigned long long)w, (unsigned long long)((x * prio_to_wmult[l]) >> PRIO_WMULT_SHIFT),
+                   (unsigned long long)(x / w));
+            return 1;
+        }
+    }
+    
+    printf("prio_to_wmult: inverse of the weight table and an exact tick charge at all %d levels\n",
+           PRIO_TABLE_SIZE);
+    return 0;
+}
+
+int main(void) {
+    return check_wmult() | check_ms_to_ticks();
+}
@@ -0,0 +1,9 @@
+/* common.h - Host stand-in for the kernel's common definitions */
+
+#ifndef COMMON_H
+#define COMMON_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#endif /* COMMON_H */
@@ -0,0 +1,162 @@
+/* host.c - Host-side stand-ins for the kernel services the scheduler uses */
+
+#include <string.h>
+#include "host.h"
+
+uint64_t time_elapsed;
+int disable_count;
+uint32_t irq_pending;
+uint64_t host_idle_ticks;
+
+/* Critical sections only count on the host; nothing interrupts them */
+void enter_critical(void) {
+    disable_count++;
+}
+
+void leave_critical(void) {
+    disable_count--;
+}
+
+/* util.h declares memset with a 32-bit length; the kernel objects are
+ * built with memset renamed to this */
+void *host_memset(void *s, int c, uint32_t n) {
+    return memset(s, c, n);
+}
+
+/* ========== queue.h ========== */
+
+void queue_init(queue_t *queue) {
+    queue->head = NULL;
+    queue->tail = NULL;
+    queue->size = 0;
+}
+
+void queue_put(queue_t *queue, node_t *node) {
+    node->next = NULL;
+    node->prev = queue->tail;
+    if (queue->tail != NULL) {
+        queue->tail->next = node;
+    } else {
+        queue->head = node;
+    }
+    queue->tail = node;
+    queue->size++;
+}
+
+node_t *queue_get(queue_t *queue) {
+    node_t *node = queue->head;
+    
+    if (node != NULL) {
+        queue_unlink(queue, node);
+    }
+    return node;
+}
+
+node_t *queue_peek(queue_t *queue) {
+    return queue->head;
+}
+
+int queue_size(queue_t *queue) {
+    return queue->size;
+}
+
+int queue_empty(queue_t *queue) {
+    return queue->size == 0;
+}
+
+int queue_contains(queue_t *queue, node_t *node) {
+    node_t *n;
+    
+    for (n = queue->head; n != NULL; n = n->next) {
+        if (n == node) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int queue_remove(queue_t *queue, node_t *node) {
+    if (!queue_contains(queue, node)) {
+        return -1;
+    }
+    queue_unlink(queue, node);
+    return 0;
+}
+
+void queue_clear(queue_t *queue) {
+    while (queue_get(queue) != NULL) {
+    }
+}
+
+void queue_for_each(queue_t *queue, void (*func)(node_t *, void *), void *arg) {
+    node_t *n, *next;
+    
+    for (n = queue->head; n != NULL; n = next) {
+        next = n->next;
+        func(n, arg);
+    }
+}
+
+int queue_insert_after(queue_t *queue, node_t *after, node_t *node) {
+    if (after == NULL || after == queue->tail) {
+        queue_put(queue, node);
+        return 0;
+    }
+    node->prev = after;
+    node->next = after->next;
+    after->next->prev = node;
+    after->next = node;
+    queue->size++;
+    return 0;
+}
+
+int queue_insert_before(queue_t *queue, node_t *before, node_t *node) {
+    if (before == NULL) {
+        queue_put(queue, node);
+        return 0;
+    }
+    node->next = before;
+    node->prev = before->prev;
+    if (before->prev != NULL) {
+        before->prev->next = node;
+    } else {
+        queue->head = node;
+    }
+    before->prev = node;
+    queue->size++;
+    return 0;
+}
+
+/* ========== idle.c ========== */
+
+/* The idle governor is x86 privileged code; the host has no idle state */
+void idle_init(void) {
+}
+
+/* Idle by letting simulated time pass: the ticks irq0 delivers to the
+ * idle pcb, serving sleepers only, until a wakeup lands on the CPU */
+void cpu_idle(void) {
+    rq_t *rq = cpu_rq(this_cpu());
+    int nested = disable_count;
+    
+    disable_count = 0;
+    while (!rq->need_resched && queue_empty(&rq->inbox)) {
+        time_elapsed++;
+        host_idle_ticks++;
+        scheduler_tick();
+        check_sleeping();
+    }
+    disable_count = nested;
+}
+
+/* ========== Timer interrupt ========== */
+
+void sim_tick(void) {
+    time_elapsed++;
+    scheduler_tick();
+    check_sleeping();
+    if (current_running->nested_count == 0) {
+        put_current_running();
+        scheduler_entry();
+    }
+}
@@ -0,0 +1,27 @@
+/* host.h - Host harness for running the scheduler outside the kernel */
+
+#ifndef HOST_H
+#define HOST_H
+
+#include "scheduler.h"
+#include "interrupt.h"
+#include "sched_ext.h"
+#include "sched_class.h"
+
+extern uint64_t time_elapsed;
+extern int disable_count;
+extern uint32_t irq_pending;
+extern uint64_t host_idle_ticks;  /* Ticks cpu_idle() let pass */
+
+void *host_memset(void *s, int c, uint32_t n);
+
+/**
+ * sim_tick - Deliver one timer interrupt as irq0_entry does
+ *
+ * Charges the tick, wakes due sleepers and, unless current_running is
+ * inside a system call, switches to the next process. Processes are
+ * simulated as always running in user mode.
+ */
+void sim_tick(void);
+
+#endif /* HOST_H */
@@ -0,0 +1,12 @@
+/* interrupt.h - Host stand-in for the kernel's interrupt interface */
+
+#ifndef INTERRUPT_H
+#define INTERRUPT_H
+
+#include "common.h"
+
+/* Critical sections (entry.S in the kernel, host.c here) */
+void enter_critical(void);
+void leave_critical(void);
+
+#endif /* INTERRUPT_H */
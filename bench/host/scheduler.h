@@ -0,0 +1,62 @@
+/* scheduler.h - Host stand-in for the kernel's process definitions */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "common.h"
+#include "queue.h"
+
+#define MAX_PROCESSES           64
+#define MIN_PRIORITY            0
+#define MAX_PRIORITY            31
+#define DEFAULT_PRIORITY        16
+#define MS_PER_TICK             10
+
+/* Process states */
+enum {
+    PROCESS_FREE,
+    PROCESS_READY,
+    PROCESS_RUNNING,
+    PROCESS_SLEEPING,
+    PROCESS_BLOCKED,
+    PROCESS_EXITED
+};
+
+/**
+ * struct pcb - Process control block, as the kernel lays it out
+ * @node: Link in get_ready_queue() and the sync primitives' wait queues
+ * @kernel_stack_top: Saved kernel stack pointer
+ * @nested_count: Nonzero while in a system call or for kernel threads
+ * @pid: Process id, 0 when free
+ * @status: PROCESS_* state
+ * @priority: Static priority, MIN_PRIORITY..MAX_PRIORITY
+ * @wakeup_time: time_elapsed at which a sleeper is due
+ */
+typedef struct pcb {
+    node_t node;
+    uint32_t kernel_stack_top;
+    int nested_count;
+    int pid;
+    int status;
+    int priority;
+    uint64_t wakeup_time;
+} pcb_t;
+
+extern pcb_t *current_running;
+
+/* Scheduler interface (scheduler.c) */
+void scheduler_init(void);
+pcb_t *pcb_allocate(void);
+void pcb_free(pcb_t *pcb);
+void scheduler_add(pcb_t *pcb);
+void scheduler_entry(void);
+void put_current_running(void);
+void check_sleeping(void);
+void do_sleep(uint32_t milliseconds);
+void do_yield(void);
+void do_exit(void);
+queue_t *get_ready_queue(void);
+pcb_t *get_process_by_pid(int pid);
+pcb_t *get_current_process(void);
+
+#endif /* SCHEDULER_H */
@@ -4,6 +4,7 @@
 
 .globl time_elapsed
 .globl disable_count
+.globl irq_pending
 
 .data
 time_elapsed:
@@ -13,6 +14,10 @@ time_elapsed:
 disable_count:
     .long 0
 
+/* Interrupts deferred by a soft-masked critical section, bit n for IRQ n */
+irq_pending:
+    .long 0
+
 .text
 
 /* Macro to send End Of Interrupt signal */
@@ -50,19 +55,54 @@ disable_count:
     movl current_running, %eax; \
     movl (%eax), %esp
 
+/* Interrupt enable flag in EFLAGS */
+#define EFLAGS_IF 0x200
+
+/*
+ * Critical sections are soft-masked: entering one only bumps
+ * disable_count, with no cli/sti (each of which traps under a
+ * hypervisor). An interrupt that arrives inside one is recorded in
+ * irq_pending by SOFT_MASKED and returns at once with IF clear, so
+ * nothing else arrives; the LEAVE_CRITICAL that brings the count back
+ * to zero replays it.
+ */
+
 /* Macro to enter critical section */
 #define ENTER_CRITICAL \
-    cli; \
     incl disable_count
 
-/* Macro to leave critical section */
+/* Macro to leave critical section, replaying deferred interrupts */
 #define LEAVE_CRITICAL \
     decl disable_count; \
-    cmpl $0, disable_count; \
-    jne 1f; \
-    sti; \
+    jnz 1f; \
+    cmpl $0, irq_pending; \
+    je 1f; \
+    call irq_replay; \
 1:
 
+/* Macro to defer an interrupt that arrived inside a critical section:
+   mark it pending and return with IF clear in the saved EFLAGS. The
+   EOI is left to the replay, so the PIC holds the line meanwhile. */
+#define SOFT_MASKED(irq) \
+    cmpl $0, disable_count; \
+    je 2f; \
+    orl $(1 << (irq)), irq_pending; \
+    andl $~EFLAGS_IF, 8(%esp); \
+    iret; \
+2:
+
+/* Macro to run an interrupt handler as if the hardware had raised it:
+   IF clear on entry, and an iret frame that turns interrupts back on */
+#define REPLAY_IRQ(irq, handler) \
+    btrl $(irq), irq_pending; \
+    jnc 3f; \
+    pushfl; \
+    orl $EFLAGS_IF, (%esp); \
+    pushl %cs; \
+    call handler; \
+    cli; \
+3:
+
 /* Macro to test nested count and jump if zero */
 #define TEST_NESTED_COUNT \
     movl current_running, %eax; \
@@ -74,6 +114,9 @@ disable_count:
 irq0_entry:
     /* Interrupts are already disabled by hardware */
     
+    /* Inside a critical section: defer to its LEAVE_CRITICAL */
+    SOFT_MASKED(0)
+    
     /* Increment disable_count since interrupts are off */
     incl disable_count
     
@@ -89,6 +132,9 @@ irq0_entry:
     /* Send End Of Interrupt signal */
     SEND_EOI
     
+    /* Charge this tick to the running process */
+    call scheduler_tick
+    
     /* Test nested_count and branch accordingly */
     TEST_NESTED_COUNT
     
@@ -144,6 +190,9 @@ sysentry:
     call system_call_helper
     addl $4, %esp
     
+    /* Switch now if the call woke a process that should preempt us */
+    call preempt_check_resched
+    
     RESTORE_STACK
     RESTORE_REGS
     LEAVE_CRITICAL
@@ -152,6 +201,7 @@ sysentry:
 /* Exception handlers (simplified) */
 .globl irq7_entry
 irq7_entry:
+    SOFT_MASKED(7)
     ENTER_CRITICAL
     SAVE_REGS
     
@@ -162,3 +212,28 @@ irq7_entry:
     RESTORE_REGS
     LEAVE_CRITICAL
     iret
+
+/* Run the interrupts deferred while soft-masked, highest priority
+   first, then enable interrupts. Called with disable_count at zero and
+   IF clear; preserves all registers, as the handlers do. A handler may
+   switch processes, exactly as the real interrupt would have here. */
+irq_replay:
+    cli
+4:
+    REPLAY_IRQ(0, irq0_entry)
+    REPLAY_IRQ(7, irq7_entry)
+    cmpl $0, irq_pending
+    jne 4b
+    sti
+    ret
+
+/* C entry to the critical section macros */
+.globl enter_critical
+enter_critical:
+    ENTER_CRITICAL
+    ret
+
+.globl leave_critical
+leave_critical:
+    LEAVE_CRITICAL
+    ret
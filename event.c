@@ -0,0 +1,37 @@
+/* event.c - Event counters (kernel side) */
+
+#include "event.h"
+#include "handle.h"
+#include "wait.h"
+#include "interrupt.h"
+#include "common.h"
+
+/* Readable while anything is counted; event_read() takes the count */
+static int event_try_wait(waitable_t *obj, pcb_t *pcb) {
+    return *((kevent_t *)obj)->count != 0;
+}
+
+/* Set up the kernel object of an event */
+void kevent_init(kevent_t *ev, volatile uint64_t *count) {
+    waitable_init(&ev->wait, event_try_wait);
+    ev->own = 0;
+    ev->count = count != NULL ? count : &ev->own;
+}
+
+/* Set up an event counter with a count of zero */
+int do_event_init(event_t *ev) {
+    if (ev == NULL) {
+        return -1;
+    }
+    
+    ev->count = 0;
+    ev->waiters = 0;
+    ev->handle = handle_create_shared(HANDLE_EVENT, &ev->count);
+    
+    return ev->handle < 0 ? -1 : 0;
+}
+
+/* Wake the readers blocked on an event */
+int do_event_wake(int handle) {
+    return handle_wake(handle, HANDLE_EVENT);
+}
@@ -0,0 +1,115 @@
+/* event.h - Event counters: coalescing, eventfd-like notifications */
+
+#ifndef EVENT_H
+#define EVENT_H
+
+#include "wait.h"
+#include "syslib.h"
+#include "common.h"
+
+/**
+ * struct event - 64-bit event counter shared by signallers and readers
+ * @count: Signals not yet read
+ * @waiters: Readers about to block or blocked; event_signal() enters the
+ *           kernel only while it is non-zero
+ * @handle: Kernel object (HANDLE_EVENT) the readers block on
+ *
+ * Signalling adds to @count and only enters the kernel when a reader is
+ * blocked. Reading takes the whole count at once and blocks (through
+ * sys_handle_wait_any() on @handle) only while it is zero, so any number
+ * of signals between two reads cost the reader a single wakeup.
+ *
+ * The event must live in memory shared by the threads that use it. Only
+ * @count is read by the kernel, and never written; the wait queue is in
+ * the kernel object. As a sys_handle_wait_any() object @handle fires
+ * while @count is non-zero; the count itself is left for event_read().
+ */
+typedef struct event {
+    volatile uint64_t count;
+    volatile int waiters;
+    int handle;
+} event_t;
+
+/**
+ * struct kevent - Kernel object behind an event's handle
+ * @wait: Waitable header
+ * @count: The counter: @own for an event created by do_handle_create(),
+ *         the event_t's for one set up by do_event_init()
+ * @own: Counter kept in the kernel object
+ */
+typedef struct kevent {
+    waitable_t wait;
+    volatile uint64_t *count;
+    uint64_t own;
+} kevent_t;
+
+/**
+ * kevent_init - Set up the kernel object of an event
+ * @ev: Kernel object
+ * @count: Counter in shared memory, or NULL to use @ev->own
+ */
+void kevent_init(kevent_t *ev, volatile uint64_t *count);
+
+/**
+ * do_event_init - Set up an event counter with a count of zero
+ * @ev: Event in the caller's memory
+ *
+ * Creates the kernel object the readers block on; event_destroy()
+ * closes it again.
+ *
+ * Return: 0 on success, -1 on a bad argument or when out of handles
+ */
+int do_event_init(event_t *ev);
+
+/**
+ * do_event_wake - Wake the readers blocked on an event
+ * @handle: The event's handle
+ *
+ * Return: Number of processes woken (0 if the count is still zero),
+ *         -1 if @handle is not an event
+ */
+int do_event_wake(int handle);
+
+/* ========== USER-SPACE FAST PATHS ========== */
+
+/* Add n to the counter; enters the kernel only if a reader is blocked */
+static inline void event_signal(event_t *ev, uint64_t n) {
+    __sync_fetch_and_add(&ev->count, n);
+    
+    /* A reader counts itself in @waiters before the kernel rechecks the
+     * count, so either it sees this signal or we see it waiting */
+    if (ev->waiters != 0) {
+        sys_event_wake(ev->handle);
+    }
+}
+
+/* Take the whole count without blocking, 0 if nothing was signalled */
+static inline uint64_t event_try_read(event_t *ev) {
+    uint64_t n;
+    
+    do {
+        n = ev->count;
+    } while (n != 0 && !__sync_bool_compare_and_swap(&ev->count, n, 0));
+    
+    return n;
+}
+
+/* Take the whole count, blocking while it is zero */
+static inline uint64_t event_read(event_t *ev) {
+    uint64_t n;
+    
+    while ((n = event_try_read(ev)) == 0) {
+        __sync_fetch_and_add(&ev->waiters, 1);
+        sys_handle_wait_any(&ev->handle, 1, WAIT_INFINITE);
+        __sync_fetch_and_sub(&ev->waiters, 1);
+    }
+    
+    return n;
+}
+
+/* Release the kernel object of an event nobody uses any more */
+static inline void event_destroy(event_t *ev) {
+    sys_handle_close(ev->handle);
+}
+
+#endif /* EVENT_H */
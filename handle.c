@@ -0,0 +1,336 @@
+/* handle.c - Kernel object pool and handle table */
+
+#include "handle.h"
+#include "event.h"
+#include "latch.h"
+#include "wait.h"
+#include "slab.h"
+#include "interrupt.h"
+#include "common.h"
+
+/* Handle table; a handle's low bits index it directly */
+static kobj_t kobj_table[MAX_HANDLES];
+
+/* Head of the free slot list, -1 when the table is full */
+static int kobj_free;
+
+/* Object caches; objects are freed with an empty wait queue, as built */
+static kmem_cache_t event_cache;
+static kmem_cache_t latch_cache;
+static kmem_cache_t sem_cache;
+
+/* Priority order state of objects created with HANDLE_PRIO */
+static kmem_cache_t prio_cache;
+
+static void event_ctor(void *obj) {
+    kevent_init((kevent_t *)obj, NULL);
+}
+
+static void latch_ctor(void *obj) {
+    klatch_init((klatch_t *)obj, NULL);
+}
+
+/* A waiter gets through by taking one unit, which for a lock makes it
+ * the holder */
+static int sem_try_wait(waitable_t *obj, pcb_t *pcb) {
+    ksem_t *sem = (ksem_t *)obj;
+    
+    if (sem->count <= 0) {
+        return 0;
+    }
+    sem->count--;
+    sem->owner = pcb->pid;
+    return 1;
+}
+
+static void sem_ctor(void *obj) {
+    waitable_init(&((ksem_t *)obj)->wait, sem_try_wait);
+    ((ksem_t *)obj)->count = 0;
+    ((ksem_t *)obj)->owner = 0;
+}
+
+/* Cache the objects of a type come from */
+static kmem_cache_t* kobj_cache(int type) {
+    if (type == HANDLE_EVENT) {
+        return &event_cache;
+    }
+    if (type == HANDLE_SEMAPHORE || type == HANDLE_LOCK) {
+        return &sem_cache;
+    }
+    return &latch_cache;
+}
+
+/* Object a handle refers to, or NULL if it is stale or malformed */
+static kobj_t* handle_lookup(int handle) {
+    int slot = handle & HANDLE_INDEX_MASK;
+    kobj_t *obj;
+    
+    if (handle < 0 || slot >= MAX_HANDLES) {
+        return NULL;
+    }
+    
+    obj = &kobj_table[slot];
+    if (obj->type == HANDLE_FREE ||
+        obj->gen != ((uint32_t)handle >> HANDLE_INDEX_BITS)) {
+        return NULL;
+    }
+    
+    return obj;
+}
+
+/* Nonzero if an object's counter is in user memory, where the kernel
+ * must not write */
+static int kobj_shared(kobj_t *obj) {
+    if (obj->type == HANDLE_SEMAPHORE || obj->type == HANDLE_LOCK) {
+        return 0;
+    }
+    if (obj->type == HANDLE_EVENT) {
+        return ((kevent_t *)obj->obj)->count != &((kevent_t *)obj->obj)->own;
+    }
+    return ((klatch_t *)obj->obj)->count != &((klatch_t *)obj->obj)->own;
+}
+
+/* Set up the object pool */
+void handle_init(void) {
+    int i;
+    
+    for (i = 0; i < MAX_HANDLES; i++) {
+        kobj_table[i].gen = 1;
+        kobj_table[i].type = HANDLE_FREE;
+        kobj_table[i].next_free = i + 1 < MAX_HANDLES ? i + 1 : -1;
+        kobj_table[i].obj = NULL;
+    }
+    kobj_free = 0;
+    
+    kmem_cache_init(&event_cache, "event", sizeof(kevent_t), event_ctor);
+    kmem_cache_init(&latch_cache, "latch", sizeof(klatch_t), latch_ctor);
+    kmem_cache_init(&sem_cache, "sem", sizeof(ksem_t), sem_ctor);
+    kmem_cache_init(&prio_cache, "wait_prio", sizeof(wait_prio_t), NULL);
+}
+
+/* Fill a free slot with a new object; counter is its shared counter, or
+ * NULL to keep one in the object starting at arg */
+static int handle_alloc(int type, int arg, int ordered, volatile void *counter) {
+    kobj_t *obj;
+    kevent_t *kev;
+    klatch_t *kl;
+    wait_prio_t *prio = NULL;
+    int slot;
+    
+    enter_critical();
+    
+    if (kobj_free < 0) {
+        leave_critical();
+        return -1;
+    }
+    slot = kobj_free;
+    obj = &kobj_table[slot];
+    
+    /* The caches hand out constructed objects; only the counter is set */
+    obj->obj = kmem_cache_alloc(kobj_cache(type));
+    if (obj->obj == NULL) {
+        leave_critical();
+        return -1;
+    }
+    if (type == HANDLE_EVENT) {
+        kev = (kevent_t *)obj->obj;
+        kev->own = 0;
+        kev->count = counter != NULL ? counter : &kev->own;
+    } else if (type == HANDLE_SEMAPHORE || type == HANDLE_LOCK) {
+        ((ksem_t *)obj->obj)->count = arg;
+        ((ksem_t *)obj->obj)->owner = 0;
+    } else {
+        kl = (klatch_t *)obj->obj;
+        kl->own = arg;
+        kl->count = counter != NULL ? counter : &kl->own;
+    }
+    
+    if (ordered) {
+        prio = kmem_cache_alloc(&prio_cache);
+        if (prio == NULL) {
+            kmem_cache_free(kobj_cache(type), obj->obj);
+            obj->obj = NULL;
+            leave_critical();
+            return -1;
+        }
+        waitable_set_prio(obj->obj, prio);
+    }
+    
+    kobj_free = obj->next_free;
+    obj->type = type;
+    
+    leave_critical();
+    return ((int)obj->gen << HANDLE_INDEX_BITS) | slot;
+}
+
+/* Create a kernel object, returns its handle or -1 */
+int do_handle_create(int type, int arg) {
+    int ordered = type & HANDLE_PRIO;
+    
+    type &= ~HANDLE_PRIO;
+    if (type < HANDLE_EVENT || type > HANDLE_LOCK ||
+        ((type == HANDLE_LATCH || type == HANDLE_SEMAPHORE) && arg < 0)) {
+        return -1;
+    }
+    if (type == HANDLE_COMPLETION || type == HANDLE_LOCK) {
+        arg = 1;
+    }
+    
+    return handle_alloc(type, arg, ordered, NULL);
+}
+
+/* Create the kernel object of a shared-memory event or latch */
+int handle_create_shared(int type, volatile void *counter) {
+    if ((type != HANDLE_EVENT && type != HANDLE_LATCH) || counter == NULL) {
+        return -1;
+    }
+    
+    return handle_alloc(type, 0, 0, counter);
+}
+
+/* Wake the waiters of an object of the given type */
+int handle_wake(int handle, int type) {
+    kobj_t *obj;
+    int woken;
+    
+    enter_critical();
+    
+    obj = handle_lookup(handle);
+    if (obj == NULL || obj->type != type) {
+        leave_critical();
+        return -1;
+    }
+    woken = waitable_wake(obj->obj);
+    
+    leave_critical();
+    return woken;
+}
+
+/* Destroy a kernel object; its waiters return WAIT_ERROR */
+int do_handle_close(int handle) {
+    kobj_t *obj;
+    
+    enter_critical();
+    
+    obj = handle_lookup(handle);
+    if (obj == NULL) {
+        leave_critical();
+        return -1;
+    }
+    
+    waitable_abort(obj->obj);
+    
+    /* Back to FIFO, the state the caches hand objects out in */
+    if (obj->obj->prio != NULL) {
+        kmem_cache_free(&prio_cache, obj->obj->prio);
+        obj->obj->prio = NULL;
+    }
+    kmem_cache_free(kobj_cache(obj->type), obj->obj);
+    
+    obj->obj = NULL;
+    obj->type = HANDLE_FREE;
+    obj->gen = (obj->gen + 1) & HANDLE_GEN_MASK;
+    obj->next_free = kobj_free;
+    kobj_free = obj - kobj_table;
+    
+    leave_critical();
+    return 0;
+}
+
+/* Signal an object: an event counts one more, a latch one fewer, a
+ * semaphore hands out a unit and a lock is released */
+int do_handle_signal(int handle) {
+    kobj_t *obj;
+    klatch_t *kl;
+    ksem_t *sem;
+    
+    enter_critical();
+    
+    obj = handle_lookup(handle);
+    if (obj == NULL || kobj_shared(obj)) {
+        leave_critical();
+        return -1;
+    }
+    
+    if (obj->type == HANDLE_SEMAPHORE || obj->type == HANDLE_LOCK) {
+        /* Only the holder of a lock can release it */
+        sem = (ksem_t *)obj->obj;
+        if (obj->type == HANDLE_LOCK &&
+            (sem->count > 0 || current_running == NULL || sem->owner != current_running->pid)) {
+            leave_critical();
+            return -1;
+        }
+        sem->owner = 0;
+        sem->count++;
+        waitable_wake(obj->obj);
+    } else if (obj->type == HANDLE_EVENT) {
+        ((kevent_t *)obj->obj)->own++;
+        waitable_wake(obj->obj);
+    } else {
+        kl = (klatch_t *)obj->obj;
+        if (kl->own > 0 && --kl->own == 0) {
+            waitable_wake(obj->obj);
+        }
+    }
+    
+    leave_critical();
+    return 0;
+}
+
+/* Take an event's count, or read the arrivals a latch still expects or
+ * the units a semaphore has left */
+int do_handle_read(int handle, uint64_t *value) {
+    kobj_t *obj;
+    kevent_t *kev;
+    
+    if (value == NULL) {
+        return -1;
+    }
+    
+    enter_critical();
+    
+    obj = handle_lookup(handle);
+    if (obj == NULL || kobj_shared(obj)) {
+        leave_critical();
+        return -1;
+    }
+    
+    if (obj->type == HANDLE_EVENT) {
+        kev = (kevent_t *)obj->obj;
+        *value = kev->own;
+        kev->own = 0;
+    } else if (obj->type == HANDLE_SEMAPHORE || obj->type == HANDLE_LOCK) {
+        *value = ((ksem_t *)obj->obj)->count;
+    } else {
+        *value = ((klatch_t *)obj->obj)->own;
+    }
+    
+    leave_critical();
+    return 0;
+}
+
+/* do_wait_any() on kernel objects named by handle */
+int do_handle_wait_any(int handles[], int n, int timeout) {
+    waitable_t *objects[WAIT_ANY_MAX];
+    kobj_t *obj;
+    int i, result;
+    
+    if (handles == NULL || n < 1 || n > WAIT_ANY_MAX) {
+        return WAIT_ERROR;
+    }
+    
+    enter_critical();
+    
+    for (i = 0; i < n; i++) {
+        obj = handle_lookup(handles[i]);
+        if (obj == NULL) {
+            leave_critical();
+            return WAIT_ERROR;
+        }
+        objects[i] = obj->obj;
+    }
+    result = do_wait_any(objects, n, timeout);
+    
+    leave_critical();
+    return result;
+}
@@ -0,0 +1,97 @@
+/* handle.h - Kernel-allocated sync objects referenced by handles */
+
+#ifndef HANDLE_H
+#define HANDLE_H
+
+#include "event.h"
+#include "latch.h"
+#include "common.h"
+
+#define MAX_HANDLES             256     /* Kernel objects alive at once */
+#define HANDLE_INDEX_BITS       16
+#define HANDLE_INDEX_MASK       ((1 << HANDLE_INDEX_BITS) - 1)
+#define HANDLE_GEN_MASK         0x7fff  /* Keeps handles positive */
+
+/* Object types */
+#define HANDLE_FREE             0
+#define HANDLE_EVENT            1       /* Event counter, arg ignored */
+#define HANDLE_LATCH            2       /* Countdown latch, arg is the count */
+#define HANDLE_COMPLETION       3       /* Latch counting down from one */
+#define HANDLE_SEMAPHORE        4       /* Counting semaphore, arg is the count */
+#define HANDLE_LOCK             5       /* Lock: a semaphore of one, arg ignored */
+#define HANDLE_PRIO             0x100   /* OR into the type: wake waiters by priority */
+
+/**
+ * struct kobj - Slot of the handle table
+ * @gen: Generation, bumped every time the slot is freed
+ * @type: HANDLE_* type of the object, HANDLE_FREE if unused
+ * @next_free: Next free slot while on the free list, -1 at the end
+ * @obj: The object, from the slab cache of its type; every type starts
+ *       with its waitable header
+ *
+ * A handle is (@gen << HANDLE_INDEX_BITS) | slot, so a lookup is one
+ * array index plus a compare, and a handle kept after close no longer
+ * matches once the slot is reused. Objects live in kernel memory, so
+ * their state cannot be corrupted by the process holding the handle;
+ * the one exception is the counter of an event or latch set up by
+ * do_event_init() or do_latch_init(), which the kernel only reads.
+ */
+typedef struct kobj {
+    uint16_t gen;
+    uint16_t type;
+    int next_free;
+    waitable_t *obj;
+} kobj_t;
+
+/**
+ * struct ksem - Kernel object of a semaphore or lock handle
+ * @wait: Waitable header
+ * @count: Units available; each waiter that gets through takes one
+ * @owner: PID of the process that took the last unit, 0 once it is
+ *         given back: the holder of a lock
+ *
+ * Unlike an event or latch, a semaphore is consumed by the wait that
+ * succeeds, so a signal hands exactly one unit to exactly one waiter:
+ * the oldest, or with HANDLE_PRIO the highest priority one. A lock is
+ * held from a successful wait until the holder signals it; a signal from
+ * any other process fails.
+ */
+typedef struct ksem {
+    waitable_t wait;
+    int count;
+    int owner;
+} ksem_t;
+
+/* Set up the object pool (called from scheduler_init) */
+void handle_init(void);
+
+/**
+ * handle_create_shared - Create the kernel object of a shared-memory
+ *                        event or latch
+ * @type: HANDLE_EVENT or HANDLE_LATCH
+ * @counter: The event_t or latch_t counter; the kernel only ever reads it
+ *
+ * sys_handle_signal() and sys_handle_read() refuse the object, as they
+ * would write the counter; its users update it directly.
+ *
+ * Return: The handle, or -1 when out of handles
+ */
+int handle_create_shared(int type, volatile void *counter);
+
+/**
+ * handle_wake - Wake the waiters of an object that may have fired
+ * @handle: Handle of the object
+ * @type: HANDLE_* type the object must have
+ *
+ * Return: Number of processes woken, -1 for a stale handle or another type
+ */
+int handle_wake(int handle, int type);
+
+/* Handle system calls (kernel side) */
+int do_handle_create(int type, int arg);
+int do_handle_close(int handle);
+int do_handle_signal(int handle);
+int do_handle_read(int handle, uint64_t *value);
+int do_handle_wait_any(int handles[], int n, int timeout);
+
+#endif /* HANDLE_H */
@@ -0,0 +1,275 @@
+/* idle.c - Idle loop with a polling / HLT / MWAIT governor */
+
+#include "idle.h"
+#include "sched_ext.h"
+#include "interrupt.h"
+#include "util.h"
+#include "common.h"
+
+/* External declarations from entry.S */
+extern uint64_t time_elapsed;
+extern int disable_count;
+
+/* Idle states in TSC cycles (about 1-3 GHz); MWAIT is dropped at boot
+ * on CPUs that lack it */
+static idle_state_t idle_states[IDLE_NR_STATES] = {
+    { "poll",  0,     0      },
+    { "hlt",   2000,  20000  },
+    { "mwait", 10000, 200000 },
+};
+
+/* States this CPU supports, and the EAX hint naming the MWAIT C-state */
+static int idle_nr_states;
+static uint32_t mwait_hint;
+
+/* Per-CPU governor state: the last IDLE_HISTORY idle lengths (nr_history
+ * of them valid), the TSC rate measured against the tick, the TSC at
+ * which the current tick was first seen, and statistics */
+typedef struct idle_gov {
+    uint32_t history[IDLE_HISTORY];
+    int nr_history;
+    int next;
+    uint64_t tsc_base;
+    uint64_t tick_base;
+    uint32_t tsc_per_tick;
+    uint64_t tick_seen;
+    uint64_t tick_tsc;
+    idle_stats_t stats;
+} idle_gov_t;
+
+static idle_gov_t idle_gov[NR_CPUS];
+
+static inline uint64_t rdtsc(void) {
+    uint32_t lo, hi;
+    
+    __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static inline void cpuid(uint32_t leaf, uint32_t *a, uint32_t *b, uint32_t *c, uint32_t *d) {
+    __asm__ volatile("cpuid" : "=a"(*a), "=b"(*b), "=c"(*c), "=d"(*d) : "a"(leaf), "c"(0));
+}
+
+/* Set up the idle states and governor history */
+void idle_init(void) {
+    uint32_t max_leaf, a, b, c, d;
+    int cpu;
+    
+    /* MONITOR/MWAIT is CPUID.1:ECX bit 3; use the C2 hint when leaf 5
+     * reports C2 sub-states, C1 otherwise */
+    idle_nr_states = IDLE_HLT + 1;
+    mwait_hint = 0;
+    cpuid(0, &max_leaf, &b, &c, &d);
+    if (max_leaf >= 1) {
+        cpuid(1, &a, &b, &c, &d);
+        if (c & (1 << 3)) {
+            idle_nr_states = IDLE_MWAIT + 1;
+            if (max_leaf >= 5) {
+                cpuid(5, &a, &b, &c, &d);
+                if ((d >> 8) & 0xf) {
+                    mwait_hint = 0x10;
+                }
+            }
+        }
+    }
+    
+    for (cpu = 0; cpu < NR_CPUS; cpu++) {
+        memset(&idle_gov[cpu], 0, sizeof(idle_gov[cpu]));
+    }
+}
+
+/* Nonzero once a wakeup has been placed on the CPU, or queued on its
+ * inbox for the next pick; queued work that may not run (a throttled
+ * group) does not count */
+static int idle_has_work(rq_t *rq) {
+    return rq->need_resched || !queue_empty(&rq->inbox);
+}
+
+/* Typical recent idle length: the mean of the history, recomputed
+ * without the longest entry when that one is an outlier */
+static uint64_t idle_typical(idle_gov_t *gov) {
+    uint32_t sum = 0, max = 0;
+    int i;
+    
+    if (gov->nr_history == 0) {
+        return IDLE_NO_EVENT;
+    }
+    
+    for (i = 0; i < gov->nr_history; i++) {
+        sum += gov->history[i];
+        if (gov->history[i] > max) {
+            max = gov->history[i];
+        }
+    }
+    
+    if (gov->nr_history > 2 && max * gov->nr_history > 2 * sum) {
+        return (sum - max) / (gov->nr_history - 1);
+    }
+    return sum / gov->nr_history;
+}
+
+/* Expected idle length in TSC cycles: no longer than recent idles have
+ * typically lasted, and no later than the next tick. Sleep deadlines
+ * (wakeup_time) are served by check_sleeping() on ticks, so the next
+ * tick edge bounds the earliest of them, and the periodic tick ends the
+ * idle period even when nothing is due. */
+static uint64_t idle_predict(idle_gov_t *gov) {
+    uint64_t predicted = IDLE_NO_EVENT, typical, into_tick;
+    
+    if (gov->tsc_per_tick != 0) {
+        into_tick = rdtsc() - gov->tick_tsc;
+        predicted = into_tick < gov->tsc_per_tick ? gov->tsc_per_tick - into_tick : 0;
+    }
+    
+    typical = idle_typical(gov);
+    return typical < predicted ? typical : predicted;
+}
+
+/* Deepest supported state whose target residency fits the prediction */
+static int idle_select(uint64_t predicted) {
+    int state = IDLE_POLL;
+    
+    while (state + 1 < idle_nr_states &&
+           idle_states[state + 1].target_residency <= predicted) {
+        state++;
+    }
+    return state;
+}
+
+/* Enter an idle state, interrupts enabled. Only the halting states
+ * disable them, between their last check for work and the sti that
+ * takes effect with the hlt or mwait, so no wakeup slips in between. */
+static void idle_enter(rq_t *rq, int state) {
+    uint64_t start;
+    
+    switch (state) {
+    case IDLE_POLL:
+        /* Spin no longer than halting would have paid off */
+        start = rdtsc();
+        while (!idle_has_work(rq) &&
+               rdtsc() - start < idle_states[IDLE_HLT].target_residency) {
+            __asm__ volatile("pause" ::: "memory");
+        }
+        break;
+    case IDLE_HLT:
+        __asm__ volatile("cli" ::: "memory");
+        if (!idle_has_work(rq)) {
+            __asm__ volatile("sti; hlt" ::: "memory");
+        } else {
+            __asm__ volatile("sti" ::: "memory");
+        }
+        break;
+    case IDLE_MWAIT:
+        /* Wakers write need_resched while in_idle is set, which ends
+         * the MWAIT without an interrupt (see place_ready()) */
+        __asm__ volatile("monitor" :: "a"(&rq->need_resched), "c"(0), "d"(0));
+        __asm__ volatile("cli" ::: "memory");
+        if (!idle_has_work(rq)) {
+            __asm__ volatile("sti; mwait" :: "a"(mwait_hint), "c"(0) : "memory");
+        } else {
+            __asm__ volatile("sti" ::: "memory");
+        }
+        break;
+    }
+}
+
+/* Learn from an idle period that has ended */
+static void idle_reflect(idle_gov_t *gov, int state, uint64_t predicted, uint64_t length) {
+    uint64_t now = rdtsc();
+    uint64_t ticks;
+    
+    /* Idles end on the next tick at the latest, well inside 32 bits */
+    gov->history[gov->next] = length < 0xffffffffu ? (uint32_t)length : 0xffffffffu;
+    gov->next = (gov->next + 1) % IDLE_HISTORY;
+    if (gov->nr_history < IDLE_HISTORY) {
+        gov->nr_history++;
+    }
+    
+    gov->stats.usage[state]++;
+    gov->stats.time[state] += length;
+    if (predicted != IDLE_NO_EVENT) {
+        gov->stats.predicted += predicted;
+        gov->stats.actual += length;
+        if (2 * length < predicted) {
+            gov->stats.nr_early++;
+        } else if (length > 2 * predicted) {
+            gov->stats.nr_late++;
+        }
+    }
+    
+    /* Measure the TSC rate over 16 to 64 ticks, few enough that the
+     * cycle count fits 32 bits */
+    ticks = time_elapsed - gov->tick_base;
+    if (gov->tsc_base == 0 || ticks > 64) {
+        gov->tsc_base = now;
+        gov->tick_base = time_elapsed;
+    } else if (ticks >= 16) {
+        gov->tsc_per_tick = (uint32_t)(now - gov->tsc_base) / (uint32_t)ticks;
+        gov->tsc_base = now;
+        gov->tick_base = time_elapsed;
+    }
+}
+
+/* Wait until a process may run on this CPU */
+void cpu_idle(void) {
+    rq_t *rq = cpu_rq(this_cpu());
+    idle_gov_t *gov = &idle_gov[this_cpu()];
+    uint64_t predicted, start;
+    uint32_t flags;
+    int state, nested = disable_count;
+    
+    /* Lift the scheduler's critical sections, replaying what they
+     * deferred, so the tick and wakeups get in; the idle pcb keeps them
+     * from switching away */
+    __asm__ volatile("pushfl; popl %0" : "=r"(flags));
+    disable_count = 1;
+    leave_critical();
+    __asm__ volatile("sti" ::: "memory");
+    
+    while (!idle_has_work(rq)) {
+        /* Idle wakes on the tick interrupt, so this is close to its edge */
+        if (time_elapsed != gov->tick_seen) {
+            gov->tick_seen = time_elapsed;
+            gov->tick_tsc = rdtsc();
+        }
+        
+        predicted = idle_predict(gov);
+        state = idle_select(predicted);
+        
+        start = rdtsc();
+        idle_enter(rq, state);
+        idle_reflect(gov, state, predicted, rdtsc() - start);
+    }
+    
+    /* Back to the caller's critical sections and interrupt flag */
+    __asm__ volatile("cli" ::: "memory");
+    disable_count = nested;
+    __asm__ volatile("pushl %0; popfl" :: "r"(flags) : "memory", "cc");
+}
+
+/* Sum the idle statistics of all CPUs */
+void do_sched_idle_stats(idle_stats_t *stats) {
+    idle_stats_t *s;
+    int cpu, i;
+    
+    if (stats == NULL) {
+        return;
+    }
+    
+    enter_critical();
+    
+    memset(stats, 0, sizeof(*stats));
+    for (cpu = 0; cpu < NR_CPUS; cpu++) {
+        s = &idle_gov[cpu].stats;
+        for (i = 0; i < IDLE_NR_STATES; i++) {
+            stats->usage[i] += s->usage[i];
+            stats->time[i] += s->time[i];
+        }
+        stats->predicted += s->predicted;
+        stats->actual += s->actual;
+        stats->nr_early += s->nr_early;
+        stats->nr_late += s->nr_late;
+    }
+    
+    leave_critical();
+}
@@ -0,0 +1,72 @@
+/* idle.h - CPU idle loop and idle state governor */
+
+#ifndef IDLE_H
+#define IDLE_H
+
+#include "sched_ext.h"
+#include "common.h"
+
+/* Idle states, shallowest first */
+#define IDLE_POLL               0       /* Spin on need_resched, instant wakeup */
+#define IDLE_HLT                1       /* Halt until the next interrupt */
+#define IDLE_MWAIT              2       /* MONITOR/MWAIT on need_resched, deeper C-state */
+#define IDLE_NR_STATES          3
+
+#define IDLE_HISTORY            8       /* Past idle lengths the governor averages */
+#define IDLE_NO_EVENT           (~0ull) /* Prediction with no deadline and no history */
+
+/**
+ * struct idle_state - An idle state the governor can choose
+ * @name: State name (for debugging)
+ * @exit_latency: TSC cycles from wakeup until the CPU runs again
+ * @target_residency: Shortest idle, in TSC cycles, for which entering
+ *                    the state saves more than it costs
+ */
+typedef struct idle_state {
+    const char *name;
+    uint32_t exit_latency;
+    uint32_t target_residency;
+} idle_state_t;
+
+/**
+ * struct idle_stats - How well the governor predicted idle periods
+ * @usage: Times each state was entered
+ * @time: TSC cycles spent in each state
+ * @predicted: Sum of predicted idle lengths in TSC cycles
+ * @actual: Sum of measured idle lengths in TSC cycles
+ * @nr_early: Idles that ended before half their prediction (state too deep)
+ * @nr_late: Idles that lasted over twice their prediction (state too shallow)
+ *
+ * Summed over all CPUs by do_sched_idle_stats().
+ */
+typedef struct idle_stats {
+    uint32_t usage[IDLE_NR_STATES];
+    uint64_t time[IDLE_NR_STATES];
+    uint64_t predicted;
+    uint64_t actual;
+    uint32_t nr_early;
+    uint32_t nr_late;
+} idle_stats_t;
+
+/* Set up the idle states and governor history (called from scheduler_init) */
+void idle_init(void);
+
+/**
+ * cpu_idle - Wait until a process may run on this CPU
+ *
+ * Called by the scheduler, inside its critical sections, when a pick
+ * finds nothing to run, with the CPU's idle pcb as current_running and
+ * the run queue's in_idle set so that every wakeup placed on the CPU
+ * sets need_resched. Lifts the soft mask for the wait, so the tick
+ * serves sleep deadlines and replayed or new interrupts wake processes.
+ * Predicts how long the CPU will stay idle from the next tick and the
+ * recent idle lengths, enters the deepest state worth that long, and
+ * returns, with the caller's critical sections restored, once a wakeup
+ * has set need_resched or landed on the inbox.
+ */
+void cpu_idle(void);
+
+/* Idle statistics system call (kernel side) */
+void do_sched_idle_stats(idle_stats_t *stats);
+
+#endif /* IDLE_H */
@@ -0,0 +1,133 @@
+/* iqueue.h - Compact queues of slot indices into a fixed object array */
+
+#ifndef IQUEUE_H
+#define IQUEUE_H
+
+#include "common.h"
+
+#define IQ_NONE                 0xffff  /* End of queue / not queued */
+
+/**
+ * struct ilink - Links of one object, kept in an array parallel to the
+ *                objects themselves
+ * @prev: Index of the previous object in its queue, or IQ_NONE
+ * @next: Index of the next object in its queue, or IQ_NONE
+ *
+ * Four bytes instead of the eight of a node_t, and kept apart from the
+ * objects, so walking a queue touches a dense link array rather than
+ * one cache line per object.
+ */
+typedef struct ilink {
+    uint16_t prev;
+    uint16_t next;
+} ilink_t;
+
+/**
+ * struct iqueue - FIFO of object indices
+ * @head: Index of the first object, or IQ_NONE
+ * @tail: Index of the last object, or IQ_NONE
+ * @size: Number of objects in the queue
+ *
+ * Every object in the queue must take its links from the same ilink_t
+ * array, which each operation is passed. All operations are O(1).
+ */
+typedef struct iqueue {
+    uint16_t head;
+    uint16_t tail;
+    uint16_t size;
+} iqueue_t;
+
+/* Make a queue empty */
+static inline void iqueue_init(iqueue_t *q) {
+    q->head = IQ_NONE;
+    q->tail = IQ_NONE;
+    q->size = 0;
+}
+
+/* Nonzero if the queue holds nothing */
+static inline int iqueue_empty(const iqueue_t *q) {
+    return q->head == IQ_NONE;
+}
+
+/* Add object i at the tail */
+static inline void iqueue_put(iqueue_t *q, ilink_t *links, int i) {
+    links[i].prev = q->tail;
+    links[i].next = IQ_NONE;
+    if (q->tail != IQ_NONE) {
+        links[q->tail].next = i;
+    } else {
+        q->head = i;
+    }
+    q->tail = i;
+    q->size++;
+}
+
+/* Add object i at the head */
+static inline void iqueue_push(iqueue_t *q, ilink_t *links, int i) {
+    links[i].prev = IQ_NONE;
+    links[i].next = q->head;
+    if (q->head != IQ_NONE) {
+        links[q->head].prev = i;
+    } else {
+        q->tail = i;
+    }
+    q->head = i;
+    q->size++;
+}
+
+/* Add object i right behind object at, or at the head if at is IQ_NONE */
+static inline void iqueue_insert_after(iqueue_t *q, ilink_t *links, int at, int i) {
+    if (at == IQ_NONE) {
+        iqueue_push(q, links, i);
+        return;
+    }
+    links[i].prev = at;
+    links[i].next = links[at].next;
+    if (links[at].next != IQ_NONE) {
+        links[links[at].next].prev = i;
+    } else {
+        q->tail = i;
+    }
+    links[at].next = i;
+    q->size++;
+}
+
+/* Remove object i, which must be in the queue */
+static inline void iqueue_unlink(iqueue_t *q, ilink_t *links, int i) {
+    if (links[i].prev != IQ_NONE) {
+        links[links[i].prev].next = links[i].next;
+    } else {
+        q->head = links[i].next;
+    }
+    if (links[i].next != IQ_NONE) {
+        links[links[i].next].prev = links[i].prev;
+    } else {
+        q->tail = links[i].prev;
+    }
+    links[i].prev = IQ_NONE;
+    links[i].next = IQ_NONE;
+    q->size--;
+}
+
+/* Remove object i if it is in the queue, returns 1 if it was. Only
+ * valid when i is in this queue or in none: an unqueued object has no
+ * predecessor and is not the head, which is checked in O(1). */
+static inline int iqueue_remove(iqueue_t *q, ilink_t *links, int i) {
+    if (links[i].prev == IQ_NONE && q->head != i) {
+        return 0;
+    }
+    iqueue_unlink(q, links, i);
+    return 1;
+}
+
+/* Remove and return the object at the head, or IQ_NONE if empty */
+static inline int iqueue_get(iqueue_t *q, ilink_t *links) {
+    int i = q->head;
+    
+    if (i != IQ_NONE) {
+        iqueue_unlink(q, links, i);
+    }
+    return i;
+}
+
+#endif /* IQUEUE_H */
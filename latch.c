@@ -0,0 +1,37 @@
+/* latch.c - Countdown latches and completions (kernel side) */
+
+#include "latch.h"
+#include "handle.h"
+#include "wait.h"
+#include "interrupt.h"
+#include "common.h"
+
+/* Open latches let everyone through and are not consumed */
+static int latch_try_wait(waitable_t *obj, pcb_t *pcb) {
+    return *((klatch_t *)obj)->count <= 0;
+}
+
+/* Set up the kernel object of a latch */
+void klatch_init(klatch_t *l, volatile int *count) {
+    waitable_init(&l->wait, latch_try_wait);
+    l->own = 0;
+    l->count = count != NULL ? count : &l->own;
+}
+
+/* Set up a latch */
+int do_latch_init(latch_t *l, int count) {
+    if (l == NULL || count < 0) {
+        return -1;
+    }
+    
+    l->count = count;
+    l->waiters = 0;
+    l->handle = handle_create_shared(HANDLE_LATCH, &l->count);
+    
+    return l->handle < 0 ? -1 : 0;
+}
+
+/* Release the processes blocked on an open latch */
+int do_latch_wake(int handle) {
+    return handle_wake(handle, HANDLE_LATCH);
+}
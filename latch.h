@@ -0,0 +1,116 @@
+/* latch.h - Countdown latches and one-shot completions */
+
+#ifndef LATCH_H
+#define LATCH_H
+
+#include "wait.h"
+#include "syslib.h"
+#include "common.h"
+
+/**
+ * struct latch - Gate that opens once a count reaches zero
+ * @count: Arrivals still expected
+ * @waiters: Processes about to block or blocked; latch_count_down()
+ *           enters the kernel only while it is non-zero
+ * @handle: Kernel object (HANDLE_LATCH) the waiters block on
+ *
+ * Participants count down with a user-space atomic decrement. Only the
+ * one that takes @count to zero enters the kernel, and only if someone
+ * is blocked; waiters block only while @count is still positive. Once
+ * open, a latch stays open until it is destroyed and initialised again.
+ *
+ * The latch must live in memory shared by the threads that use it. Only
+ * @count is read by the kernel, and never written; the wait queue is in
+ * the kernel object. As a sys_handle_wait_any() object @handle fires,
+ * for every waiter at once, when the latch opens.
+ */
+typedef struct latch {
+    volatile int count;
+    volatile int waiters;
+    int handle;
+} latch_t;
+
+/* A completion is a latch counting down from one */
+typedef latch_t completion_t;
+
+/**
+ * struct klatch - Kernel object behind a latch's handle
+ * @wait: Waitable header
+ * @count: The counter: @own for a latch created by do_handle_create(),
+ *         the latch_t's for one set up by do_latch_init()
+ * @own: Counter kept in the kernel object
+ */
+typedef struct klatch {
+    waitable_t wait;
+    volatile int *count;
+    int own;
+} klatch_t;
+
+/**
+ * klatch_init - Set up the kernel object of a latch
+ * @l: Kernel object
+ * @count: Counter in shared memory, or NULL to use @l->own
+ */
+void klatch_init(klatch_t *l, volatile int *count);
+
+/**
+ * do_latch_init - Set up a latch
+ * @l: Latch in the caller's memory
+ * @count: Arrivals before it opens (0 opens it at once)
+ *
+ * Creates the kernel object the waiters block on; latch_destroy()
+ * closes it again.
+ *
+ * Return: 0 on success, -1 on a bad argument or when out of handles
+ */
+int do_latch_init(latch_t *l, int count);
+
+/**
+ * do_latch_wake - Release the processes blocked on an open latch
+ * @handle: The latch's handle
+ *
+ * Return: Number of processes woken, -1 if @handle is not a latch
+ */
+int do_latch_wake(int handle);
+
+/* ========== USER-SPACE FAST PATHS ========== */
+
+/* Record one arrival; the last one releases the waiters */
+static inline void latch_count_down(latch_t *l) {
+    /* A waiter counts itself in @waiters before the kernel rechecks the
+     * count, so either it sees the latch open or we see it waiting */
+    if (__sync_sub_and_fetch(&l->count, 1) == 0 && l->waiters != 0) {
+        sys_latch_wake(l->handle);
+    }
+}
+
+/* Block until the latch has opened */
+static inline void latch_wait(latch_t *l) {
+    while (l->count > 0) {
+        __sync_fetch_and_add(&l->waiters, 1);
+        sys_handle_wait_any(&l->handle, 1, WAIT_INFINITE);
+        __sync_fetch_and_sub(&l->waiters, 1);
+    }
+}
+
+/* Release the kernel object of a latch nobody uses any more */
+static inline void latch_destroy(latch_t *l) {
+    sys_handle_close(l->handle);
+}
+
+/* Set up a completion that has not happened yet */
+static inline void completion_init(completion_t *c) {
+    sys_latch_init(c, 1);
+}
+
+/* Signal the completion, releasing every waiter (later calls do nothing) */
+static inline void complete(completion_t *c) {
+    latch_count_down(c);
+}
+
+/* Block until the completion has been signalled */
+static inline void wait_for_completion(completion_t *c) {
+    latch_wait(c);
+}
+
+#endif /* LATCH_H */
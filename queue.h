@@ -175,6 +175,31 @@ int queue_insert_after(queue_t *queue, node_t *after, node_t *node);
  */
 int queue_insert_before(queue_t *queue, node_t *before, node_t *node);
 
+/**
+ * queue_unlink - Remove a node known to be in a queue
+ * @queue: Pointer to the queue holding @node
+ * @node: Pointer to node to remove
+ *
+ * Like queue_remove() without the membership check, for callers that
+ * track which queue a node is on.
+ * Time complexity: O(1)
+ */
+static inline void queue_unlink(queue_t *queue, node_t *node) {
+    if (node->prev != NULL) {
+        node->prev->next = node->next;
+    } else {
+        queue->head = node->next;
+    }
+    if (node->next != NULL) {
+        node->next->prev = node->prev;
+    } else {
+        queue->tail = node->prev;
+    }
+    node->prev = NULL;
+    node->next = NULL;
+    queue->size--;
+}
+
 /* ========== HELPER MACROS ========== */
 
 /**
@@ -0,0 +1,142 @@
+/* sched_batch.c - Background scheduling classes: SCHED_BATCH and SCHED_IDLE */
+
+#include "scheduler.h"
+#include "sched_ext.h"
+#include "sched_class.h"
+#include "queue.h"
+#include "common.h"
+
+/* The fair-only variant has no background classes */
+#if !CONFIG_SCHED_FAIR_ONLY
+
+/*
+ * Both classes are plain round-robin queues that rank below the fair
+ * class, so they never preempt it and are preempted as soon as a fair or
+ * real-time process wakes. They differ only in precedence and quantum:
+ * SCHED_BATCH gets long quanta for throughput, SCHED_IDLE runs only when
+ * SCHED_BATCH has nothing either.
+ */
+
+/* Queue a process, resuming a preempted one ahead of the others */
+static void bg_enqueue(bg_rq_t *bg, pcb_t *pcb, int flags, int timeslice) {
+    pcb_ext_t *ext = pcb_ext(pcb);
+    
+    if ((flags & ENQUEUE_PREEMPTED) && ext->slice > 0) {
+        rq_queue_push(&bg->ready, pcb);
+    } else {
+        if (ext->slice <= 0) {
+            ext->slice = timeslice;
+        }
+        rq_queue_put(&bg->ready, pcb);
+    }
+}
+
+/* Rotate the running process once its quantum is used up */
+static void bg_tick(rq_t *rq, pcb_t *curr) {
+    if (curr != NULL && --pcb_ext(curr)->slice <= 0) {
+        pcb_ext(curr)->slice = 0;
+        rq->need_resched = 1;
+    }
+}
+
+/* bg_tick() for every tick after from up to upto at once */
+static void bg_catch_up(rq_t *rq, pcb_t *curr, uint64_t from, uint64_t upto) {
+    pcb_ext_t *ext;
+    
+    if (curr == NULL) {
+        return;
+    }
+    ext = pcb_ext(curr);
+    if (ext->slice <= 0 || (uint64_t)ext->slice <= upto - from) {
+        ext->slice = 0;
+        rq->need_resched = 1;
+    } else {
+        ext->slice -= (int)(upto - from);
+    }
+}
+
+/* ========== SCHED_BATCH ========== */
+
+static void batch_enqueue(rq_t *rq, pcb_t *pcb, int flags) {
+    bg_enqueue(&rq->batch, pcb, flags, BATCH_TIMESLICE);
+}
+
+static void batch_dequeue(rq_t *rq, pcb_t *pcb) {
+    rq_queue_remove(&rq->batch.ready, pcb);
+}
+
+static pcb_t* batch_pick_next(rq_t *rq) {
+    return rq_queue_get(&rq->batch.ready);
+}
+
+static void batch_yield(rq_t *rq, pcb_t *curr) {
+    pcb_ext(curr)->slice = 0;
+    bg_enqueue(&rq->batch, curr, 0, BATCH_TIMESLICE);
+}
+
+static int batch_nr_running(rq_t *rq) {
+    return rq->batch.ready.size;
+}
+
+const sched_class_t batch_sched_class = {
+    .name       = "batch",
+    .next       = &idle_sched_class,
+    .enqueue    = batch_enqueue,
+    .dequeue    = batch_dequeue,
+    .pick_next  = batch_pick_next,
+    .tick       = bg_tick,
+    .catch_up   = bg_catch_up,
+    .yield      = batch_yield,
+    .wakeup     = NULL,
+    .nr_running = batch_nr_running,
+};
+
+/* ========== SCHED_IDLE ========== */
+
+static void idle_enqueue(rq_t *rq, pcb_t *pcb, int flags) {
+    bg_enqueue(&rq->idle, pcb, flags, IDLE_TIMESLICE);
+}
+
+static void idle_dequeue(rq_t *rq, pcb_t *pcb) {
+    rq_queue_remove(&rq->idle.ready, pcb);
+}
+
+static pcb_t* idle_pick_next(rq_t *rq) {
+    return rq_queue_get(&rq->idle.ready);
+}
+
+static void idle_yield(rq_t *rq, pcb_t *curr) {
+    pcb_ext(curr)->slice = 0;
+    bg_enqueue(&rq->idle, curr, 0, IDLE_TIMESLICE);
+}
+
+static int idle_nr_running(rq_t *rq) {
+    return rq->idle.ready.size;
+}
+
+const sched_class_t idle_sched_class = {
+    .name       = "idle",
+    .next       = NULL,
+    .enqueue    = idle_enqueue,
+    .dequeue    = idle_dequeue,
+    .pick_next  = idle_pick_next,
+    .tick       = bg_tick,
+    .catch_up   = bg_catch_up,
+    .yield      = idle_yield,
+    .wakeup     = NULL,
+    .nr_running = idle_nr_running,
+};
+
+/* ========== SETUP ========== */
+
+/* Set up the per-CPU SCHED_BATCH and SCHED_IDLE queues */
+void bg_init(void) {
+    int cpu;
+    
+    for (cpu = 0; cpu < NR_CPUS; cpu++) {
+        iqueue_init(&cpu_rq(cpu)->batch.ready);
+        iqueue_init(&cpu_rq(cpu)->idle.ready);
+    }
+}
+
+#endif /* !CONFIG_SCHED_FAIR_ONLY */
@@ -0,0 +1,175 @@
+/* sched_class.h - Pluggable scheduling class interface */
+
+#ifndef SCHED_CLASS_H
+#define SCHED_CLASS_H
+
+#include "common.h"
+#include "scheduler.h"
+#include "sched_ext.h"
+
+/**
+ * struct sched_class - Scheduling policy operations
+ * @name: Policy name (for debugging)
+ * @next: Class with the next lower precedence, NULL for the lowest
+ * @enqueue: Queue a runnable process on @rq (pcb->status is already READY);
+ *           @flags is ENQUEUE_PREEMPTED for a process put back after
+ *           losing the CPU involuntarily, 0 otherwise
+ * @dequeue: Remove a queued process from @rq
+ * @pick_next: Remove and return the process to run next on @rq, or NULL
+ * @tick: Account one timer tick; @curr is the running process if it
+ *        belongs to this class, NULL otherwise. Sets rq->need_resched
+ *        when @curr should be preempted.
+ * @catch_up: Account the ticks after @from up to and including @upto at
+ *            once, leaving the state @tick would have left; @curr as for
+ *            @tick. Used when a stopped tick restarts.
+ * @yield: Requeue @curr, which gives up the CPU voluntarily
+ * @wakeup: Called after a blocked process was enqueued on @rq; sets
+ *          rq->need_resched if it should preempt a running process of
+ *          the same class (the core handles higher-class wakeups)
+ * @nr_running: Number of processes of this class queued on @rq
+ *
+ * The core asks each class in precedence order for a process to run, so
+ * a class only gets the CPU when every class above it has nothing ready.
+ * All operations are called inside a critical section.
+ */
+typedef struct sched_class {
+    const char *name;
+    const struct sched_class *next;
+    
+    void (*enqueue)(rq_t *rq, pcb_t *pcb, int flags);
+    void (*dequeue)(rq_t *rq, pcb_t *pcb);
+    pcb_t *(*pick_next)(rq_t *rq);
+    void (*tick)(rq_t *rq, pcb_t *curr);
+    void (*catch_up)(rq_t *rq, pcb_t *curr, uint64_t from, uint64_t upto);
+    void (*yield)(rq_t *rq, pcb_t *curr);
+    void (*wakeup)(rq_t *rq, pcb_t *pcb);
+    int (*nr_running)(rq_t *rq);
+} sched_class_t;
+
+/* enqueue() flags */
+#define ENQUEUE_PREEMPTED   0x1
+
+/* Highest precedence class; follow sched_class_next() for the rest, and
+ * call hooks through sched_call(). With CONFIG_SCHED_FAIR_ONLY the chain
+ * is the fair class alone and its hooks are called directly, so the
+ * tick and pick paths load no vtable. */
+#if CONFIG_SCHED_FAIR_ONLY
+#define sched_class_highest     (&fair_sched_class)
+#define sched_class_next(class) ((const sched_class_t *)NULL)
+#define sched_call(class, hook) fair_##hook
+
+void fair_enqueue(rq_t *rq, pcb_t *pcb, int flags);
+void fair_dequeue(rq_t *rq, pcb_t *pcb);
+pcb_t *fair_pick_next(rq_t *rq);
+void fair_tick(rq_t *rq, pcb_t *curr);
+void fair_catch_up(rq_t *rq, pcb_t *curr, uint64_t from, uint64_t upto);
+void fair_yield(rq_t *rq, pcb_t *curr);
+int fair_nr_running(rq_t *rq);
+#else
+extern const sched_class_t *const sched_class_highest;
+#define sched_class_next(class) ((class)->next)
+#define sched_call(class, hook) ((class)->hook)
+#endif
+
+/* Scheduling classes */
+extern const sched_class_t fair_sched_class;
+#if !CONFIG_SCHED_FAIR_ONLY
+extern const sched_class_t rt_sched_class;
+extern const sched_class_t batch_sched_class;
+extern const sched_class_t idle_sched_class;
+#endif
+
+/* ========== CORE HELPERS FOR CLASSES ========== */
+
+/**
+ * process_slot - Get a process table entry by index
+ * @slot: Index in 0..MAX_PROCESSES-1
+ *
+ * Return: Pointer to the PCB in that slot (which may be free)
+ */
+pcb_t *process_slot(int slot);
+
+/*
+ * Class run queues are iqueue_t lists of process slots; their links live
+ * in rq_links[], parallel to process_table. A process is on at most one
+ * class queue at a time.
+ */
+extern ilink_t rq_links[MAX_PROCESSES];
+
+/* Queue a process at the tail of a class run queue */
+static inline void rq_queue_put(iqueue_t *q, pcb_t *pcb) {
+    iqueue_put(q, rq_links, pcb_slot(pcb));
+}
+
+/* Queue a process at the head of a class run queue */
+static inline void rq_queue_push(iqueue_t *q, pcb_t *pcb) {
+    iqueue_push(q, rq_links, pcb_slot(pcb));
+}
+
+/* Remove a process if it is on the queue (see iqueue_remove()) */
+static inline int rq_queue_remove(iqueue_t *q, pcb_t *pcb) {
+    return iqueue_remove(q, rq_links, pcb_slot(pcb));
+}
+
+/* Remove and return the process at the head, or NULL */
+static inline pcb_t* rq_queue_get(iqueue_t *q) {
+    int slot = iqueue_get(q, rq_links);
+    
+    return slot == IQ_NONE ? NULL : process_slot(slot);
+}
+
+/* Process at the head, or NULL */
+static inline pcb_t* rq_queue_peek(iqueue_t *q) {
+    return q->head == IQ_NONE ? NULL : process_slot(q->head);
+}
+
+/**
+ * sched_enqueue - Place a runnable process on an allowed CPU
+ * @pcb: Process to queue
+ *
+ * Chooses the CPU, marks the process READY and hands it to its class.
+ */
+void sched_enqueue(pcb_t *pcb);
+
+/**
+ * sched_dequeue - Remove a READY process from its run queue
+ * @pcb: Process to remove
+ */
+void sched_dequeue(pcb_t *pcb);
+
+/**
+ * resched_cpu - Make a CPU pick again at its next scheduling point
+ * @cpu: CPU id
+ *
+ * Restarts the CPU's tick if it was stopped and sets its need_resched,
+ * which also ends cpu_idle() there. For class state changed behind the
+ * enqueue and wakeup paths, which do this themselves.
+ */
+void resched_cpu(int cpu);
+
+#if !CONFIG_SCHED_FAIR_ONLY
+/* ========== REAL-TIME CLASS ========== */
+
+/* Set up the per-CPU real-time queues */
+void rt_init(void);
+#endif
+
+/* ========== FAIR CLASS ========== */
+
+/* Set up the group and gang tables */
+void fair_init(void);
+
+/* Attach a new process to its creator's group (parent may be NULL) */
+void fair_fork(pcb_t *pcb, pcb_t *parent);
+
+/* Detach a freed process from its group and gang */
+void fair_exit(pcb_t *pcb);
+
+#if !CONFIG_SCHED_FAIR_ONLY
+/* ========== BACKGROUND CLASSES ========== */
+
+/* Set up the per-CPU SCHED_BATCH and SCHED_IDLE queues */
+void bg_init(void);
+#endif
+
+#endif /* SCHED_CLASS_H */
@@ -0,0 +1,600 @@
+/* sched_ext.h - Per-PCB scheduling state and per-CPU run queues */
+
+#ifndef SCHED_EXT_H
+#define SCHED_EXT_H
+
+#include "common.h"
+#include "queue.h"
+#include "iqueue.h"
+#include "scheduler.h"
+
+/* Number of CPUs the scheduler manages (build with -DNR_CPUS=n for SMP) */
+#ifndef NR_CPUS
+#define NR_CPUS 1
+#endif
+
+/*
+ * Build-time scheduler variants (build with -DCONFIG_...=0 or 1). Options
+ * that are off are constant-folded out of the tick, wakeup and pick paths
+ * instead of being tested on every timer interrupt.
+ *   CONFIG_SMP             - Cross-CPU placement and idle stealing
+ *   CONFIG_SCHED_STATS     - Wakeup, migration, throttle and gang counters
+ *   CONFIG_SCHED_FAIR_ONLY - SCHED_NORMAL only; the real-time and
+ *                            background classes leave the class chain
+ */
+#ifndef CONFIG_SMP
+#define CONFIG_SMP              (NR_CPUS > 1)
+#endif
+#ifndef CONFIG_SCHED_STATS
+#define CONFIG_SCHED_STATS      1
+#endif
+#ifndef CONFIG_SCHED_FAIR_ONLY
+#define CONFIG_SCHED_FAIR_ONLY  0
+#endif
+
+#if !CONFIG_SMP && NR_CPUS > 1
+#error "NR_CPUS > 1 requires CONFIG_SMP"
+#endif
+
+/* Bump a statistics counter, or nothing without CONFIG_SCHED_STATS */
+#if CONFIG_SCHED_STATS
+#define schedstat_inc(var)      ((var)++)
+#else
+#define schedstat_inc(var)      ((void)sizeof(var))
+#endif
+
+/**
+ * cpumask_t - Set of CPUs, one bit per CPU id
+ *
+ * Bit n set means CPU n is allowed. NR_CPUS must not exceed 32.
+ */
+typedef uint32_t cpumask_t;
+
+#define CPU_MASK_NONE   ((cpumask_t)0)
+#define CPU_MASK_ALL    ((cpumask_t)(0xffffffffu >> (32 - NR_CPUS)))
+#define cpu_mask(cpu)   ((cpumask_t)1 << (cpu))
+
+struct sched_class;
+
+/* Scheduling policies (sys_setscheduler) */
+#define SCHED_NORMAL            0       /* Fair class, weighted groups */
+#define SCHED_FIFO              1       /* Real-time, runs until it blocks or yields */
+#define SCHED_RR                2       /* Real-time, round-robin within a priority */
+#define SCHED_BATCH             3       /* Background throughput work, long quanta */
+#define SCHED_IDLE              5       /* Runs only when nothing else wants the CPU */
+
+/* Fair-class priority levels: pcb->priority, higher values run first */
+#define PRIO_LEVELS             (MAX_PRIORITY - MIN_PRIORITY + 1)
+#define PRIO_BITMAP_WORDS       ((PRIO_LEVELS + 31) / 32)
+#define AGING_TICKS             10      /* Wait that raises a queued process one level */
+#define FAIR_LEVEL_GANG         (-1)    /* pcb_ext.level while on a gang queue */
+
+/* Process slot and PID allocation */
+#define SLOT_MAP_WORDS          ((MAX_PROCESSES + 31) / 32)
+#define PID_SLOT_BITS           10      /* Low PID bits name the slot */
+#define PID_SLOT_MASK           ((1 << PID_SLOT_BITS) - 1)
+#define PID_GEN_MAX             ((1 << (30 - PID_SLOT_BITS)) - 1)   /* Keeps PIDs positive */
+
+/* Thread groups */
+#define MAX_GROUPS              8
+#define ROOT_GROUP              0       /* Default group, cannot be destroyed */
+#define GROUP_WEIGHT_MIN        1
+#define GROUP_WEIGHT_MAX        65536
+#define GROUP_WEIGHT_DEFAULT    1024
+#define GROUP_VRUNTIME_SCALE    (1 << 20)   /* vruntime added per tick at weight 1 */
+#define GROUP_QUOTA_UNLIMITED   0       /* quota value meaning no bandwidth cap */
+#define GROUP_PERIOD_DEFAULT    10      /* Bandwidth period in ticks (100ms) */
+
+/* Fair class time slice */
+#define FAIR_TARGET_LATENCY     4       /* Ticks in which each runnable process runs once */
+#define FAIR_MIN_GRANULARITY    1       /* Shortest slice, however loaded the CPU */
+#define FAIR_WAKEUP_GRANULARITY (GROUP_VRUNTIME_SCALE / GROUP_WEIGHT_DEFAULT)  /* vruntime lead that preempts on wakeup */
+
+/* Fair-class priority weights: a process's slice doubles every
+ * PRIO_WEIGHT_STEP levels above DEFAULT_PRIORITY and halves every
+ * PRIO_WEIGHT_STEP levels below it */
+#define PRIO_WEIGHT_SHIFT       10      /* Weight of DEFAULT_PRIORITY is 1 << 10 */
+#define PRIO_WMULT_SHIFT        32      /* Inverse weights are 2^32 / weight, rounded up */
+#define PRIO_WEIGHT_STEP        8       /* Levels per doubling of the weight */
+#define PRIO_TABLE_SIZE         64      /* Levels the inverse weight table covers */
+#define FAIR_SLICE_UNIT         (1 << PRIO_WEIGHT_SHIFT)    /* pcb_ext.slice per tick (fair) */
+
+/* 2^(r/8) and 2^(-r/8) in units of 1/1024, for r = 0..7 */
+#define PRIO_WEIGHT_UP(r)       ((r) == 0 ? 1024 : (r) == 1 ? 1117 : (r) == 2 ? 1218 : \
+                                 (r) == 3 ? 1328 : (r) == 4 ? 1448 : (r) == 5 ? 1579 : \
+                                 (r) == 6 ? 1722 : 1878)
+#define PRIO_WEIGHT_DOWN(r)     ((r) == 0 ? 1024 : (r) == 1 ? 939 : (r) == 2 ? 861 : \
+                                 (r) == 3 ? 790 : (r) == 4 ? 724 : (r) == 5 ? 664 : \
+                                 (r) == 6 ? 609 : 558)
+
+/* Weight of fair level l (pcb->priority - MIN_PRIORITY), never below 2
+ * so that its inverse fits in 32 bits; a constant expression, from which
+ * sched_fair.c builds prio_to_wmult[] */
+#define PRIO_LEVEL_DEFAULT      (DEFAULT_PRIORITY - MIN_PRIORITY)
+#define PRIO_WEIGHT_RAW(l)      ((l) >= PRIO_LEVEL_DEFAULT ? \
+    PRIO_WEIGHT_UP(((l) - PRIO_LEVEL_DEFAULT) % PRIO_WEIGHT_STEP) << \
+        (((l) - PRIO_LEVEL_DEFAULT) / PRIO_WEIGHT_STEP) : \
+    PRIO_WEIGHT_DOWN((PRIO_LEVEL_DEFAULT - (l)) % PRIO_WEIGHT_STEP) >> \
+        ((PRIO_LEVEL_DEFAULT - (l)) / PRIO_WEIGHT_STEP))
+#define PRIO_WEIGHT(l)          (PRIO_WEIGHT_RAW(l) > 1 ? (uint32_t)PRIO_WEIGHT_RAW(l) : 2u)
+
+/* Gang scheduling */
+#define MAX_GANGS               8
+#define GANG_NONE               (-1)    /* pcb_ext.gang of ungrouped processes */
+#define GANG_SLICE              2       /* Ticks of gang priority per member sharing a CPU */
+
+/* Real-time classes */
+#define RT_PRIO_LEVELS          100     /* Static priorities 0..99, 99 is highest */
+#define RT_BITMAP_WORDS         ((RT_PRIO_LEVELS + 31) / 32)
+#define RT_RR_TIMESLICE         10      /* SCHED_RR quantum in ticks */
+#define RT_PERIOD               100     /* Runaway protection period in ticks */
+#define RT_RUNTIME              95      /* Ticks per period real-time may use */
+
+/* Background classes */
+#define BATCH_TIMESLICE         20      /* SCHED_BATCH quantum in ticks (200ms) */
+#define IDLE_TIMESLICE          10      /* SCHED_IDLE quantum in ticks */
+
+/* Wakeup placement */
+#define CACHE_HOT_TICKS         2       /* Ran this recently: cache still warm */
+#define MIGRATION_COST          1       /* Cost of leaving a hot cache, in queued processes */
+
+/**
+ * struct pcb_ext - Scheduling state kept alongside each PCB
+ * @sched_class: Scheduling class that queues and picks the process
+ * @policy: SCHED_* policy the class was chosen from
+ * @rt_priority: Static real-time priority (SCHED_FIFO/SCHED_RR only)
+ * @slice: Ticks left in the current quantum (SCHED_RR, SCHED_BATCH, SCHED_IDLE),
+ *         or FAIR_SLICE_UNITs left (SCHED_NORMAL)
+ * @affinity: CPUs this process may run on
+ * @cpu: CPU whose run queue currently holds (or last held) the process
+ * @group: Thread group the process is charged to
+ * @gang: Gang the process is co-scheduled with, or GANG_NONE
+ * @last_cpu: CPU the process last ran on
+ * @last_ran: time_elapsed of the last tick the process was running
+ * @level: Fair-class priority level the process is queued at, or
+ *         FAIR_LEVEL_GANG on a gang queue
+ * @aged_at: time_elapsed of the fair-class enqueue or last aging step
+ * @wait_nr: Wait queues the process is registered on by do_wait_any()
+ * @wait_result: Outcome of its last do_wait_any() (object index or WAIT_*)
+ * @sleep_index: Entry in the sleeper wakeup table, -1 when not sleeping
+ *
+ * Stored in a table parallel to process_table, so the PCB layout that
+ * entry.S depends on is left untouched.
+ */
+typedef struct pcb_ext {
+    const struct sched_class *sched_class;
+    int policy;
+    int rt_priority;
+    int slice;
+    cpumask_t affinity;  /* Allowed CPUs (never empty) */
+    int cpu;             /* Run queue the process is placed on */
+    int group;           /* Index into the group table */
+    int gang;            /* Index into the gang table, or GANG_NONE */
+    int last_cpu;        /* Where its cache footprint is */
+    uint64_t last_ran;   /* How warm that footprint still is */
+    int level;           /* Effective priority while queued */
+    uint64_t aged_at;    /* Start of the wait at @level */
+    int wait_nr;         /* 0 unless blocked in do_wait_any() */
+    int wait_result;
+    int sleep_index;
+} pcb_ext_t;
+
+/**
+ * struct sched_group - Thread group sharing one CPU share
+ * @used: Nonzero if the slot holds a group
+ * @weight: Relative CPU share against the other groups
+ * @inv_weight: GROUP_VRUNTIME_SCALE / @weight, the vruntime charged per
+ *              tick, kept so the tick path does not divide
+ * @nr_members: Number of live processes in the group
+ * @quota: Ticks the group may run per period, or GROUP_QUOTA_UNLIMITED
+ * @period: Length of a bandwidth period in ticks
+ * @runtime: Ticks used in the current period
+ * @period_start: time_elapsed at which the current period began
+ * @throttled: Nonzero while the group has exhausted its quota
+ * @throttled_since: time_elapsed at which the group was last throttled
+ * @throttled_time: Total ticks spent throttled (closed intervals only)
+ * @nr_throttled: Number of periods in which the group was throttled
+ *
+ * While throttled, the group's processes stay on their ready queues but
+ * are skipped by the scheduler until scheduler_tick() replenishes the
+ * quota at the next period boundary.
+ */
+typedef struct sched_group {
+    int used;
+    int weight;
+    uint32_t inv_weight;
+    int nr_members;
+    int quota;
+    int period;
+    int runtime;
+    uint64_t period_start;
+    int throttled;
+    uint64_t throttled_since;
+    uint64_t throttled_time;
+    uint32_t nr_throttled;
+} sched_group_t;
+
+/**
+ * struct sched_gang - Set of processes scheduled as a unit
+ * @used: Nonzero if the slot holds a gang
+ * @nr_members: Number of live processes in the gang
+ * @nr_slices: Number of gang slices started (for tuning)
+ *
+ * When the scheduler picks a gang member, every other ready member is
+ * moved to the gang queues of distinct allowed CPUs and runs ahead of the
+ * normal group pick for GANG_SLICE ticks per member queued on that CPU.
+ * Threads meeting at a barrier then arrive together instead of waiting
+ * for a descheduled peer. Members the slice does not reach go back to
+ * the head of their group queue, as if they had never left it.
+ */
+typedef struct sched_gang {
+    int used;
+    int nr_members;
+    uint32_t nr_slices;
+} sched_gang_t;
+
+/**
+ * struct group_rq - A group's share of one CPU's run queue
+ * @ready: Runnable members of the group placed on this CPU, one FIFO per
+ *         effective priority level
+ * @bitmap: Bit l set when @ready[l] is non-empty
+ * @nr_queued: Number of processes on all of @ready
+ * @vruntime: CPU time received on this CPU, scaled by 1/weight
+ *
+ * Members are queued at their static priority and rise one level for
+ * every AGING_TICKS they wait, so low priorities cannot starve. Each FIFO
+ * stays ordered by aged_at, so only its head ever needs checking.
+ */
+typedef struct group_rq {
+    iqueue_t ready[PRIO_LEVELS];
+    uint32_t bitmap[PRIO_BITMAP_WORDS];
+    int nr_queued;
+    uint64_t vruntime;   /* Weighted ticks; the lowest runnable group runs */
+} group_rq_t;
+
+/**
+ * struct fair_rq - Run queue of the fair (normal) scheduling class
+ * @groups: Per-group ready queues, indexed by group id
+ * @min_vruntime: vruntime of the last group picked (monotonic)
+ * @gang_ready: Members of @active_gang waiting to run on this CPU
+ * @active_gang: Gang whose slice is running on this CPU, or GANG_NONE
+ * @gang_expires: time_elapsed at which the gang slice ends
+ * @slice: Ticks a process runs once dispatched, recomputed on every
+ *         enqueue, dequeue and pick as the target latency divided by the
+ *         number of runnable fair processes (at least FAIR_MIN_GRANULARITY)
+ *
+ * The fair class first picks the runnable group with the lowest vruntime,
+ * then the process at the front of that group's ready queue.
+ */
+typedef struct fair_rq {
+    group_rq_t groups[MAX_GROUPS];
+    uint64_t min_vruntime;
+    iqueue_t gang_ready;
+    int active_gang;
+    uint64_t gang_expires;
+    int slice;
+} fair_rq_t;
+
+/**
+ * struct rt_rq - Run queue of the real-time scheduling classes
+ * @queues: One FIFO per static priority
+ * @bitmap: Bit p set when @queues[p] is non-empty
+ * @nr_running: Number of queued real-time processes
+ * @rt_time: Ticks real-time processes ran in the current period
+ * @period_start: time_elapsed at which the current period began
+ * @throttled: Nonzero once @rt_time reached RT_RUNTIME this period
+ *
+ * Picking is a scan of RT_BITMAP_WORDS words for the highest set bit.
+ * The throttle keeps a runaway real-time loop from starving the rest
+ * of the system for more than RT_RUNTIME out of every RT_PERIOD ticks.
+ */
+typedef struct rt_rq {
+    iqueue_t queues[RT_PRIO_LEVELS];
+    uint32_t bitmap[RT_BITMAP_WORDS];
+    int nr_running;
+    int rt_time;
+    uint64_t period_start;
+    int throttled;
+} rt_rq_t;
+
+/**
+ * struct bg_rq - Run queue of a background scheduling class
+ * @ready: Runnable processes, round-robin with the class's quantum
+ */
+typedef struct bg_rq {
+    iqueue_t ready;
+} bg_rq_t;
+
+/**
+ * struct rq - Per-CPU run queue
+ * @cpu: CPU this run queue belongs to
+ * @need_resched: Set when the running process should give up the CPU at
+ *                the next scheduling point
+ * @inbox: Processes woken by code that queues on get_ready_queue()
+ *         directly; handed to their class on the next pick
+ * @rt: Real-time class queues (not with CONFIG_SCHED_FAIR_ONLY)
+ * @fair: Fair class queues
+ * @batch: SCHED_BATCH queue (not with CONFIG_SCHED_FAIR_ONLY)
+ * @idle: SCHED_IDLE queue (not with CONFIG_SCHED_FAIR_ONLY)
+ * @nr_wakeups: Wakeups issued from this CPU
+ * @nr_wake_prev: ... placed on the woken process's previous CPU
+ * @nr_wake_affine: ... placed on this (the waker's) CPU
+ * @nr_wake_idle: ... placed on another, idle CPU
+ * @nr_migrations: Dispatches on this CPU of a process that last ran elsewhere
+ * @tick_stopped: Nonzero while the CPU runs its only runnable process
+ *                without class ticks (nohz-full)
+ * @tick_stopped_at: Last tick accounted before the tick was stopped
+ * @tick_curr: Process the stopped ticks are charged to on restart
+ * @in_idle: Nonzero while the CPU looks for work and idles in cpu_idle()
+ *           until @need_resched; every wakeup placed on it then sets it
+ *
+ * Each scheduling class keeps its own queues here; see sched_class.h.
+ */
+typedef struct rq {
+    int cpu;
+    int need_resched;
+    queue_t inbox;
+#if !CONFIG_SCHED_FAIR_ONLY
+    rt_rq_t rt;
+#endif
+    fair_rq_t fair;
+#if !CONFIG_SCHED_FAIR_ONLY
+    bg_rq_t batch;
+    bg_rq_t idle;
+#endif
+    uint32_t nr_wakeups;
+    uint32_t nr_wake_prev;
+    uint32_t nr_wake_affine;
+    uint32_t nr_wake_idle;
+    uint32_t nr_migrations;
+    int tick_stopped;
+    uint64_t tick_stopped_at;
+    pcb_t *tick_curr;
+    int in_idle;
+} rq_t;
+
+/**
+ * struct sched_wake_stats - Wakeup placement counters summed over CPUs
+ *
+ * Field meanings match the counters of the same name in struct rq.
+ */
+typedef struct sched_wake_stats {
+    uint32_t nr_wakeups;
+    uint32_t nr_wake_prev;
+    uint32_t nr_wake_affine;
+    uint32_t nr_wake_idle;
+    uint32_t nr_migrations;
+} sched_wake_stats_t;
+
+/* ========== PRIORITY BITMAPS ========== */
+
+/* Mark a priority level as non-empty */
+static inline void prio_bitmap_set(uint32_t *bitmap, int level) {
+    bitmap[level >> 5] |= (uint32_t)1 << (level & 31);
+}
+
+/* Mark a priority level as empty */
+static inline void prio_bitmap_clear(uint32_t *bitmap, int level) {
+    bitmap[level >> 5] &= ~((uint32_t)1 << (level & 31));
+}
+
+/* Lowest non-empty priority level above level, or -1 if none */
+static inline int prio_bitmap_next_above(const uint32_t *bitmap, int words, int level) {
+    int w = (level + 1) >> 5;
+    uint32_t bits;
+    
+    if (w >= words) {
+        return -1;
+    }
+    bits = bitmap[w] & ~(((uint32_t)1 << ((level + 1) & 31)) - 1);
+    for (;;) {
+        if (bits != 0) {
+            return (w << 5) + __builtin_ctz(bits);
+        }
+        if (++w >= words) {
+            return -1;
+        }
+        bits = bitmap[w];
+    }
+}
+
+/* Highest non-empty priority level, or -1 if none */
+static inline int prio_bitmap_highest(const uint32_t *bitmap, int words) {
+    int w;
+    
+    for (w = words - 1; w >= 0; w--) {
+        if (bitmap[w] != 0) {
+            return (w << 5) + 31 - __builtin_clz(bitmap[w]);
+        }
+    }
+    
+    return -1;
+}
+
+/* ========== TICK PERIODS ========== */
+
+/* ticks % period without the 64-bit divide libgcc would supply: the high
+ * word is reduced first, so one divl finishes the job on i386 */
+static inline uint32_t ticks_mod(uint64_t ticks, uint32_t period) {
+#if defined(__i386__)
+    uint32_t lo = (uint32_t)ticks, hi = (uint32_t)(ticks >> 32) % period;
+    
+    __asm__("divl %2" : "+a"(lo), "+d"(hi) : "rm"(period));
+    return hi;
+#else
+    return (uint32_t)(ticks % period);
+#endif
+}
+
+/* Last of the period boundaries first, first + period, ... that is not
+ * after upto (first <= upto); the tick path never needs the divide */
+static inline uint64_t period_last(uint64_t first, uint64_t upto, uint32_t period) {
+    if (upto - first < period) {
+        return first;
+    }
+    return upto - ticks_mod(upto - first, period);
+}
+
+/**
+ * this_cpu - Id of the CPU executing the caller
+ *
+ * Return: CPU id in 0..NR_CPUS-1 (a constant 0 without CONFIG_SMP)
+ */
+#if CONFIG_SMP
+int this_cpu(void);
+#else
+#define this_cpu()              0
+#endif
+
+/**
+ * rq_nr_running - Number of runnable processes queued on a run queue
+ * @rq: Run queue of a CPU
+ *
+ * Return: Processes of all classes on @rq, not counting the running one
+ */
+int rq_nr_running(rq_t *rq);
+
+/**
+ * pcb_ext - Get the scheduling state of a PCB
+ * @pcb: PCB from the process table
+ *
+ * Return: Pointer to the matching pcb_ext_t entry
+ */
+pcb_ext_t *pcb_ext(pcb_t *pcb);
+
+/**
+ * pcb_slot - Get the process table index of a PCB
+ * @pcb: PCB from the process table
+ *
+ * Return: Index in 0..MAX_PROCESSES-1, for tables parallel to process_table
+ */
+int pcb_slot(pcb_t *pcb);
+
+/**
+ * cpu_rq - Get the run queue of a CPU
+ * @cpu: CPU id
+ *
+ * Return: Pointer to that CPU's run queue
+ */
+rq_t *cpu_rq(int cpu);
+
+/**
+ * scheduler_tick - Per-tick accounting, called from irq0_entry
+ *
+ * Passes the tick to every scheduling class, with the running process to
+ * the class it belongs to.
+ */
+void scheduler_tick(void);
+
+/**
+ * ms_to_ticks - Convert a duration to timer ticks, rounding up
+ * @milliseconds: Duration in milliseconds
+ *
+ * Return: Number of ticks
+ */
+uint32_t ms_to_ticks(uint32_t milliseconds);
+
+/**
+ * scheduler_block - Take the caller off the CPU
+ * @status: State to leave it in (PROCESS_BLOCKED, PROCESS_SLEEPING, ...)
+ *
+ * The caller must already be queued wherever its wakeup will find it.
+ * The next process is chosen here; the switch itself happens on return
+ * to assembly, as for do_sleep().
+ */
+void scheduler_block(int status);
+
+/**
+ * sleep_enqueue - Put a process on the sleep queue until a given tick
+ * @pcb: Process about to block
+ * @wakeup_time: time_elapsed at which check_sleeping() wakes it
+ */
+void sleep_enqueue(pcb_t *pcb, uint64_t wakeup_time);
+
+/**
+ * sleep_dequeue - Take a sleeping process off the sleep queue
+ * @pcb: Process with pcb_ext(pcb)->sleep_index != -1
+ */
+void sleep_dequeue(pcb_t *pcb);
+
+/**
+ * sleep_scan_expired - Find expired entries of a wakeup table
+ * @wake: Low 32 bits of each sleeper's wakeup_time
+ * @n: Number of entries
+ * @now: Low 32 bits of time_elapsed
+ * @mask: Output, bit i set if @wake[i] has passed; (n + 31) / 32 words
+ *
+ * Entries compare as (int32_t)(now - wake) >= 0, which is exact for
+ * sleeps shorter than 2^31 ticks and survives the low word wrapping.
+ * Uses SSE2 or AVX2 when the kernel is built with them.
+ *
+ * Return: Number of expired entries
+ */
+int sleep_scan_expired(const uint32_t *wake, int n, uint32_t now, uint32_t *mask);
+
+/**
+ * preempt_check_resched - Reschedule at a safe point if one is due
+ *
+ * Called by sysentry once the system call is done, with the caller's
+ * stack saved, so a process woken with a better claim to the CPU runs
+ * right away instead of at the next timer tick.
+ */
+void preempt_check_resched(void);
+
+/**
+ * scheduler_wakeup - Make a blocked process runnable
+ * @pcb: Process leaving a wait queue
+ *
+ * Sync primitives (semaphore_up(), condition_signal(), ...) call this
+ * instead of putting the process on get_ready_queue() directly, so that
+ * the wake-affine placement policy picks its CPU.
+ */
+void scheduler_wakeup(pcb_t *pcb);
+
+/* Affinity system calls (kernel side) */
+int do_setaffinity(int pid, cpumask_t mask);
+cpumask_t do_getaffinity(int pid);
+
+/* Nohz-full CPU set (kernel side) */
+int do_sched_setnohz(cpumask_t mask);
+
+/**
+ * fair_needs_tick - Whether a fair process depends on the periodic tick
+ * @pcb: Running process of the fair class
+ *
+ * Return: Nonzero if a bandwidth quota or gang slice of @pcb has to be
+ * enforced on tick boundaries, so its CPU may not stop the tick
+ */
+int fair_needs_tick(pcb_t *pcb);
+
+/* Thread group system calls (kernel side) */
+int do_group_create(int weight);
+int do_group_destroy(int gid);
+int do_group_setweight(int gid, int weight);
+int do_group_move(int pid, int gid);
+int do_group_setquota(int gid, int quota, int period);
+int do_group_throttled_time(int gid, uint64_t *ticks);
+
+/* 2^PRIO_WMULT_SHIFT / weight for each fair level (pcb->priority -
+ * MIN_PRIORITY), the weight being 1 << PRIO_WEIGHT_SHIFT at
+ * DEFAULT_PRIORITY, so that dividing by a weight is a multiply and a
+ * shift */
+extern const uint32_t prio_to_wmult[PRIO_TABLE_SIZE];
+
+/* Fair class slice tuning (kernel side) */
+int do_sched_setlatency(int ticks);
+int do_sched_getlatency(void);
+
+/* Gang system calls (kernel side) */
+int do_gang_create(void);
+int do_gang_destroy(int gang);
+int do_gang_join(int pid, int gang);
+
+/* Scheduling policy system calls (kernel side) */
+int do_setscheduler(int pid, int policy, int priority);
+int do_getscheduler(int pid);
+
+/* Wakeup placement statistics (kernel side) */
+void do_sched_wake_stats(sched_wake_stats_t *stats);
+
+#endif /* SCHED_EXT_H */
@@ -0,0 +1,958 @@
+/* sched_fair.c - Fair scheduling class: weighted thread groups, bandwidth
+ * quotas, gang scheduling, priority aging and load-adaptive time slices */
+
+#include "scheduler.h"
+#include "sched_ext.h"
+#include "sched_class.h"
+#include "queue.h"
+#include "interrupt.h"
+#include "common.h"
+
+/* External declarations from entry.S */
+extern uint64_t time_elapsed;
+
+/* Thread groups; group 0 (ROOT_GROUP) always exists */
+static sched_group_t group_table[MAX_GROUPS];
+
+/* Gangs of processes that are co-scheduled */
+static sched_gang_t gang_table[MAX_GANGS];
+
+/* Class hooks are called directly when the fair class is the only one */
+#if CONFIG_SCHED_FAIR_ONLY
+#define FAIR_HOOK
+#else
+#define FAIR_HOOK static
+#endif
+
+/* Target latency in ticks, 0 selects the fixed one-tick quantum */
+static int sched_latency = FAIR_TARGET_LATENCY;
+
+#if PRIO_LEVELS > PRIO_TABLE_SIZE
+#error "PRIO_TABLE_SIZE must cover MIN_PRIORITY..MAX_PRIORITY"
+#endif
+
+/* The inverse is rounded up, which keeps (x * wmult) >> 32 equal to
+ * x / weight for the tick charge */
+#define WMULT(l)        ((uint32_t)(((1ull << PRIO_WMULT_SHIFT) + PRIO_WEIGHT(l) - 1) / PRIO_WEIGHT(l)))
+
+#define W8(f, b)        f(b), f(b + 1), f(b + 2), f(b + 3), \
+                        f(b + 4), f(b + 5), f(b + 6), f(b + 7)
+#define W64(f)          W8(f, 0), W8(f, 8), W8(f, 16), W8(f, 24), \
+                        W8(f, 32), W8(f, 40), W8(f, 48), W8(f, 56)
+
+/* Built from constant expressions, so it costs nothing at boot and no
+ * divide is left for the tick path */
+const uint32_t prio_to_wmult[PRIO_TABLE_SIZE] = { W64(WMULT) };
+
+/* Return a group slot to its unused, uncapped state */
+static void group_reset(sched_group_t *grp, int weight) {
+    grp->used = 0;
+    grp->weight = weight;
+    grp->inv_weight = GROUP_VRUNTIME_SCALE / weight;
+    grp->nr_members = 0;
+    grp->quota = GROUP_QUOTA_UNLIMITED;
+    grp->period = GROUP_PERIOD_DEFAULT;
+    grp->runtime = 0;
+    grp->period_start = 0;
+    grp->throttled = 0;
+    grp->throttled_since = 0;
+    grp->throttled_time = 0;
+    grp->nr_throttled = 0;
+}
+
+/* Queue a process on its group's ready queue at its static priority */
+static void enqueue_group(rq_t *rq, pcb_t *pcb) {
+    pcb_ext_t *ext = pcb_ext(pcb);
+    group_rq_t *grq = &rq->fair.groups[ext->group];
+    
+    /* A group waking from idle must not bank the time it did not use */
+    if (grq->nr_queued == 0 && grq->vruntime < rq->fair.min_vruntime) {
+        grq->vruntime = rq->fair.min_vruntime;
+    }
+    
+    ext->level = pcb->priority - MIN_PRIORITY;
+    ext->aged_at = time_elapsed;
+    rq_queue_put(&grq->ready[ext->level], pcb);
+    prio_bitmap_set(grq->bitmap, ext->level);
+    grq->nr_queued++;
+}
+
+/* Remove a queued process from its group's ready queue */
+static int dequeue_group(rq_t *rq, pcb_t *pcb) {
+    pcb_ext_t *ext = pcb_ext(pcb);
+    group_rq_t *grq = &rq->fair.groups[ext->group];
+    
+    if (ext->level < 0 || !rq_queue_remove(&grq->ready[ext->level], pcb)) {
+        return 0;
+    }
+    
+    grq->nr_queued--;
+    if (iqueue_empty(&grq->ready[ext->level])) {
+        prio_bitmap_clear(grq->bitmap, ext->level);
+    }
+    return 1;
+}
+
+/* Take the highest effective priority member off a group's ready queue */
+static pcb_t* pick_from_group(group_rq_t *grq) {
+    int level = prio_bitmap_highest(grq->bitmap, PRIO_BITMAP_WORDS);
+    pcb_t *pcb;
+    
+    if (level < 0) {
+        return NULL;
+    }
+    
+    pcb = rq_queue_get(&grq->ready[level]);
+    grq->nr_queued--;
+    if (iqueue_empty(&grq->ready[level])) {
+        prio_bitmap_clear(grq->bitmap, level);
+    }
+    return pcb;
+}
+
+/* Age the queued processes every tick: each that waited AGING_TICKS at
+ * its level moves up one. Queues are ordered by aged_at, so only the
+ * heads of the non-empty levels are examined and each promotion is paid
+ * for once. */
+static void age_queues(rq_t *rq) {
+    group_rq_t *grq;
+    pcb_ext_t *ext;
+    pcb_t *pcb;
+    int g, level;
+    
+    for (g = 0; g < MAX_GROUPS; g++) {
+        grq = &rq->fair.groups[g];
+        if (grq->nr_queued == 0) {
+            continue;
+        }
+        
+        for (level = prio_bitmap_next_above(grq->bitmap, PRIO_BITMAP_WORDS, -1);
+             level >= 0 && level < PRIO_LEVELS - 1;
+             level = prio_bitmap_next_above(grq->bitmap, PRIO_BITMAP_WORDS, level)) {
+            while ((pcb = rq_queue_peek(&grq->ready[level])) != NULL) {
+                ext = pcb_ext(pcb);
+                if (time_elapsed - ext->aged_at < AGING_TICKS) {
+                    break;
+                }
+                
+                rq_queue_get(&grq->ready[level]);
+                ext->level = level + 1;
+                ext->aged_at = time_elapsed;
+                rq_queue_put(&grq->ready[level + 1], pcb);
+                prio_bitmap_set(grq->bitmap, level + 1);
+            }
+            if (iqueue_empty(&grq->ready[level])) {
+                prio_bitmap_clear(grq->bitmap, level);
+            }
+        }
+    }
+}
+
+/* Put a member the gang slice took off its group queue back at the
+ * head, where it was waiting, without restarting its aging */
+static void requeue_group_head(rq_t *rq, pcb_t *pcb) {
+    pcb_ext_t *ext = pcb_ext(pcb);
+    group_rq_t *grq = &rq->fair.groups[ext->group];
+    
+    if (grq->nr_queued == 0 && grq->vruntime < rq->fair.min_vruntime) {
+        grq->vruntime = rq->fair.min_vruntime;
+    }
+    
+    ext->level = pcb->priority - MIN_PRIORITY;
+    rq_queue_push(&grq->ready[ext->level], pcb);
+    prio_bitmap_set(grq->bitmap, ext->level);
+    grq->nr_queued++;
+}
+
+/* End a CPU's gang slice, returning unpicked members to their groups */
+static void gang_deactivate(rq_t *rq) {
+    pcb_t *pcb;
+    
+    rq->fair.active_gang = GANG_NONE;
+    while ((pcb = rq_queue_get(&rq->fair.gang_ready)) != NULL) {
+        requeue_group_head(rq, pcb);
+    }
+}
+
+static void update_slice(rq_t *rq);
+
+/* Start a gang slice: pull every ready member of the gang onto the gang
+ * queues, spreading them over distinct allowed CPUs so they run together.
+ * With fewer CPUs than members the rest follow back-to-back, each adding
+ * GANG_SLICE to the slice of the CPU it shares. */
+static void gang_activate(int gang, pcb_t *leader, rq_t *rq) {
+    pcb_t *pcb;
+    pcb_ext_t *ext;
+    rq_t *trq;
+    int i, target = rq->cpu;
+    
+    rq->fair.active_gang = gang;
+    rq->fair.gang_expires = time_elapsed + GANG_SLICE;
+    schedstat_inc(gang_table[gang].nr_slices);
+    
+    for (i = 0; i < MAX_PROCESSES; i++) {
+        pcb = process_slot(i);
+        ext = pcb_ext(pcb);
+        if (ext->gang != gang || pcb == leader ||
+            pcb->status != PROCESS_READY ||
+            ext->sched_class != &fair_sched_class ||
+            group_table[ext->group].throttled) {
+            continue;
+        }
+        
+        /* Next allowed CPU after the last one used */
+        do {
+            target = (target + 1) % NR_CPUS;
+        } while (!(ext->affinity & cpu_mask(target)));
+        
+        sched_dequeue(pcb);
+        ext->cpu = target;
+        trq = cpu_rq(target);
+        if (trq->fair.active_gang != gang) {
+            if (trq->fair.active_gang != GANG_NONE) {
+                gang_deactivate(trq);
+            }
+            trq->fair.active_gang = gang;
+            trq->fair.gang_expires = time_elapsed;
+        } else if (trq->fair.gang_expires < time_elapsed) {
+            trq->fair.gang_expires = time_elapsed;
+        }
+        trq->fair.gang_expires += GANG_SLICE;
+        ext->level = FAIR_LEVEL_GANG;
+        rq_queue_put(&trq->fair.gang_ready, pcb);
+        update_slice(trq);
+        
+        /* The other CPUs switch to the gang now, not at their next tick */
+        if (target != rq->cpu) {
+            resched_cpu(target);
+        }
+    }
+}
+
+/* Runnable group on a CPU that has received the least weighted time */
+static group_rq_t* pick_next_group(rq_t *rq) {
+    group_rq_t *best = NULL;
+    int g;
+    
+    for (g = 0; g < MAX_GROUPS; g++) {
+        /* Throttled groups stay queued but are not eligible */
+        if (rq->fair.groups[g].nr_queued == 0 || group_table[g].throttled) {
+            continue;
+        }
+        if (best == NULL || rq->fair.groups[g].vruntime < best->vruntime) {
+            best = &rq->fair.groups[g];
+        }
+    }
+    
+    return best;
+}
+
+/* Pull a process this CPU may run from another CPU's run queue */
+static pcb_t* steal_task(rq_t *rq) {
+    pcb_t *pcb;
+    iqueue_t *queue;
+    int src, g, level, slot;
+    
+    if (!CONFIG_SMP) {
+        return NULL;
+    }
+    
+    for (src = 0; src < NR_CPUS; src++) {
+        if (src == rq->cpu) {
+            continue;
+        }
+        
+        /* Gang members first: they wait for a CPU that is still busy
+         * with another member, and running them here is the point */
+        queue = &cpu_rq(src)->fair.gang_ready;
+        for (slot = queue->head; slot != IQ_NONE; slot = rq_links[slot].next) {
+            pcb = process_slot(slot);
+            if (pcb_ext(pcb)->affinity & cpu_mask(rq->cpu)) {
+                rq_queue_remove(queue, pcb);
+                return pcb;
+            }
+        }
+        
+        for (g = 0; g < MAX_GROUPS; g++) {
+            if (group_table[g].throttled) {
+                continue;
+            }
+            for (level = PRIO_LEVELS - 1; level >= 0; level--) {
+                queue = &cpu_rq(src)->fair.groups[g].ready[level];
+                for (slot = queue->head; slot != IQ_NONE; slot = rq_links[slot].next) {
+                    pcb = process_slot(slot);
+                    if (pcb_ext(pcb)->affinity & cpu_mask(rq->cpu)) {
+                        dequeue_group(cpu_rq(src), pcb);
+                        return pcb;
+                    }
+                }
+            }
+        }
+    }
+    
+    return NULL;
+}
+
+/* A group's members may run again: CPUs idling with nothing else
+ * queued (see pick_next_or_idle()) have to pick again */
+static void kick_idle_cpus(void) {
+    rq_t *rq;
+    int cpu;
+    
+    for (cpu = 0; cpu < NR_CPUS; cpu++) {
+        rq = cpu_rq(cpu);
+        if (rq->in_idle && rq_nr_running(rq) != 0) {
+            rq->need_resched = 1;
+        }
+    }
+}
+
+/* Restart the stopped ticks of CPUs running pcb, or with pcb NULL any
+ * member of group gid, before a change makes it need the tick (see
+ * fair_needs_tick()); the skipped ticks are charged as they ran */
+static void restart_ticks(int gid, pcb_t *pcb) {
+    rq_t *rq;
+    int cpu;
+    
+    for (cpu = 0; cpu < NR_CPUS; cpu++) {
+        rq = cpu_rq(cpu);
+        if (rq->tick_stopped &&
+            (rq->tick_curr == pcb || (pcb == NULL && pcb_ext(rq->tick_curr)->group == gid))) {
+            resched_cpu(cpu);
+        }
+    }
+}
+
+/* Start a new bandwidth period for every capped group that reached a
+ * period boundary in the ticks after from up to upto */
+static void replenish_groups(uint64_t from, uint64_t upto) {
+    sched_group_t *grp;
+    uint64_t first;
+    int g;
+    
+    for (g = 0; g < MAX_GROUPS; g++) {
+        grp = &group_table[g];
+        if (!grp->used || grp->quota == GROUP_QUOTA_UNLIMITED) {
+            continue;
+        }
+        first = grp->period_start + grp->period;
+        if (first <= from) {
+            first = from + 1;
+        }
+        if (first > upto) {
+            continue;
+        }
+        
+        grp->period_start = period_last(first, upto, grp->period);
+        grp->runtime = 0;
+        if (grp->throttled) {
+            grp->throttled = 0;
+            grp->throttled_time += first - grp->throttled_since;
+            kick_idle_cpus();
+        }
+    }
+}
+
+/* Slice a tick uses up: FAIR_SLICE_UNIT scaled by 1/weight, so higher
+ * priorities run longer before they give way. One multiply, no divide. */
+static uint32_t tick_slice(pcb_t *pcb) {
+    return (uint32_t)(((uint64_t)FAIR_SLICE_UNIT << PRIO_WEIGHT_SHIFT) *
+                      prio_to_wmult[pcb->priority - MIN_PRIORITY] >> PRIO_WMULT_SHIFT);
+}
+
+/* ========== CLASS OPERATIONS ========== */
+
+FAIR_HOOK int fair_nr_running(rq_t *rq) {
+    int g, count = rq->fair.gang_ready.size;
+    
+    for (g = 0; g < MAX_GROUPS; g++) {
+        count += rq->fair.groups[g].nr_queued;
+    }
+    
+    return count;
+}
+
+/* Share the target latency among the queued processes and the running one */
+static void update_slice(rq_t *rq) {
+    int slice;
+    
+    if (sched_latency == 0) {
+        rq->fair.slice = 1;
+        return;
+    }
+    
+    slice = sched_latency / (fair_nr_running(rq) + 1);
+    rq->fair.slice = slice < FAIR_MIN_GRANULARITY ? FAIR_MIN_GRANULARITY : slice;
+}
+
+FAIR_HOOK void fair_enqueue(rq_t *rq, pcb_t *pcb, int flags) {
+    pcb_ext_t *ext = pcb_ext(pcb);
+    
+    /* Members woken during their gang's slice rejoin it directly */
+    if (ext->gang != GANG_NONE && ext->gang == rq->fair.active_gang &&
+        !group_table[ext->group].throttled) {
+        ext->level = FAIR_LEVEL_GANG;
+        rq_queue_put(&rq->fair.gang_ready, pcb);
+    } else {
+        enqueue_group(rq, pcb);
+    }
+    
+    update_slice(rq);
+}
+
+FAIR_HOOK void fair_dequeue(rq_t *rq, pcb_t *pcb) {
+    if (pcb_ext(pcb)->level == FAIR_LEVEL_GANG) {
+        rq_queue_remove(&rq->fair.gang_ready, pcb);
+    } else {
+        dequeue_group(rq, pcb);
+    }
+    
+    update_slice(rq);
+}
+
+/* Next process by gang, then group vruntime, then effective priority */
+static pcb_t* pick_next_fair(rq_t *rq) {
+    fair_rq_t *frq = &rq->fair;
+    group_rq_t *grq;
+    pcb_ext_t *ext;
+    pcb_t *pcb;
+    
+    /* Members of the active gang run first until its slice expires */
+    if (frq->active_gang != GANG_NONE) {
+        if (time_elapsed >= frq->gang_expires) {
+            gang_deactivate(rq);
+        }
+        while ((pcb = rq_queue_get(&frq->gang_ready)) != NULL) {
+            ext = pcb_ext(pcb);
+            if ((ext->affinity & cpu_mask(rq->cpu)) && !group_table[ext->group].throttled) {
+                return pcb;
+            }
+            requeue_group_head(rq, pcb);
+        }
+        frq->active_gang = GANG_NONE;
+    }
+    
+    /* Pick the group first, then its highest effective priority member;
+     * the aging boost is dropped as it is dispatched */
+    grq = pick_next_group(rq);
+    if (grq != NULL) {
+        pcb = pick_from_group(grq);
+        ext = pcb_ext(pcb);
+        ext->level = pcb->priority - MIN_PRIORITY;
+        if (grq->vruntime > frq->min_vruntime) {
+            frq->min_vruntime = grq->vruntime;
+        }
+        if (ext->gang != GANG_NONE) {
+            gang_activate(ext->gang, pcb, rq);
+        }
+        return pcb;
+    }
+    
+    /* Nothing local - idle balance from the other CPUs */
+    return steal_task(rq);
+}
+
+FAIR_HOOK pcb_t* fair_pick_next(rq_t *rq) {
+    pcb_t *pcb = pick_next_fair(rq);
+    
+    /* The slice is sized for the load left once this process is off the queue */
+    if (pcb != NULL) {
+        update_slice(rq);
+        pcb_ext(pcb)->slice = rq->fair.slice * FAIR_SLICE_UNIT;
+    }
+    
+    return pcb;
+}
+
+FAIR_HOOK void fair_tick(rq_t *rq, pcb_t *curr) {
+    pcb_ext_t *ext;
+    sched_group_t *grp;
+    
+    /* Quotas are global; the boot CPU replenishes them */
+    if (rq->cpu == 0) {
+        replenish_groups(time_elapsed - 1, time_elapsed);
+    }
+    
+    age_queues(rq);
+    
+    if (curr == NULL) {
+        return;
+    }
+    
+    /* Round-robin once the slice runs out; a slice granted at lower load
+     * is cut short when more processes have queued up since */
+    ext = pcb_ext(curr);
+    if (ext->slice > rq->fair.slice * FAIR_SLICE_UNIT) {
+        ext->slice = rq->fair.slice * FAIR_SLICE_UNIT;
+    }
+    ext->slice -= (int)tick_slice(curr);
+    if (ext->slice <= 0) {
+        rq->need_resched = 1;
+    }
+    
+    /* Gang slices end on time, whatever the process slice */
+    if (rq->fair.active_gang != GANG_NONE && time_elapsed >= rq->fair.gang_expires) {
+        rq->need_resched = 1;
+    }
+    
+    /* Charge the tick to the running process's group */
+    grp = &group_table[ext->group];
+    rq->fair.groups[ext->group].vruntime += grp->inv_weight;
+    
+    /* Out of budget: the group sits out the rest of its period, the
+     * following pick in irq0_entry switches away from it */
+    grp->runtime++;
+    if (grp->quota != GROUP_QUOTA_UNLIMITED && !grp->throttled &&
+        grp->runtime >= grp->quota) {
+        grp->throttled = 1;
+        grp->throttled_since = time_elapsed;
+        schedstat_inc(grp->nr_throttled);
+        rq->need_resched = 1;
+    }
+}
+
+/* fair_tick() for every tick after from up to upto at once. Nothing was
+ * queued on rq while its tick was stopped, so there is nothing to age,
+ * and the running group had no quota (fair_needs_tick()); setting one
+ * restarts the tick first (restart_ticks()). A quota is still applied
+ * here as the ticks would have, throttling the group at most once. */
+FAIR_HOOK void fair_catch_up(rq_t *rq, pcb_t *curr, uint64_t from, uint64_t upto) {
+    pcb_ext_t *ext;
+    sched_group_t *grp;
+    uint64_t used, ran = upto - from;
+    
+    if (rq->cpu == 0) {
+        replenish_groups(from, upto);
+    }
+    
+    if (curr == NULL) {
+        return;
+    }
+    
+    ext = pcb_ext(curr);
+    if (ext->slice > rq->fair.slice * FAIR_SLICE_UNIT) {
+        ext->slice = rq->fair.slice * FAIR_SLICE_UNIT;
+    }
+    used = ran * tick_slice(curr);
+    if (ext->slice <= 0 || used >= (uint64_t)ext->slice) {
+        ext->slice = 0;
+        rq->need_resched = 1;
+    } else {
+        ext->slice -= (int)used;
+    }
+    
+    if (rq->fair.active_gang != GANG_NONE && upto >= rq->fair.gang_expires) {
+        rq->need_resched = 1;
+    }
+    
+    grp = &group_table[ext->group];
+    rq->fair.groups[ext->group].vruntime += ran * grp->inv_weight;
+    
+    /* Only the ticks since a period boundary crossed count against the
+     * quota; the one reaching it is when the group was throttled */
+    if (grp->period_start > from) {
+        ran = upto - grp->period_start + 1;
+    }
+    grp->runtime += (int)ran;
+    if (grp->quota != GROUP_QUOTA_UNLIMITED && !grp->throttled &&
+        grp->runtime >= grp->quota) {
+        grp->throttled = 1;
+        grp->throttled_since = upto - (uint64_t)(grp->runtime - grp->quota);
+        schedstat_inc(grp->nr_throttled);
+        rq->need_resched = 1;
+    }
+}
+
+FAIR_HOOK void fair_yield(rq_t *rq, pcb_t *curr) {
+    /* Back to the tail of its group, outside any gang slice */
+    enqueue_group(rq, curr);
+}
+
+static void fair_wakeup(rq_t *rq, pcb_t *pcb) {
+    pcb_t *curr = get_current_process();
+    pcb_ext_t *ext = pcb_ext(pcb);
+    pcb_ext_t *cext;
+    
+    if (curr == NULL || curr->status != PROCESS_RUNNING ||
+        pcb_ext(curr)->sched_class != &fair_sched_class ||
+        pcb_ext(curr)->cpu != rq->cpu) {
+        return;
+    }
+    cext = pcb_ext(curr);
+    
+    /* Gang slices and throttled groups are left to the tick */
+    if (rq->fair.active_gang != GANG_NONE || group_table[ext->group].throttled) {
+        return;
+    }
+    
+    /* Within a group a higher static priority preempts; across groups,
+     * one that has had clearly less CPU time than the running one */
+    if (ext->group == cext->group) {
+        if (pcb->priority > curr->priority) {
+            rq->need_resched = 1;
+        }
+    } else if (rq->fair.groups[ext->group].vruntime + FAIR_WAKEUP_GRANULARITY <
+               rq->fair.groups[cext->group].vruntime) {
+        rq->need_resched = 1;
+    }
+}
+
+const sched_class_t fair_sched_class = {
+    .name       = "fair",
+#if CONFIG_SCHED_FAIR_ONLY
+    .next       = NULL,
+#else
+    .next       = &batch_sched_class,
+#endif
+    .enqueue    = fair_enqueue,
+    .dequeue    = fair_dequeue,
+    .pick_next  = fair_pick_next,
+    .tick       = fair_tick,
+    .catch_up   = fair_catch_up,
+    .yield      = fair_yield,
+    .wakeup     = fair_wakeup,
+    .nr_running = fair_nr_running,
+};
+
+/* ========== SETUP ========== */
+
+/* Set up the per-CPU fair queues and the group and gang tables */
+void fair_init(void) {
+    rq_t *rq;
+    int cpu, g, i;
+    
+    for (cpu = 0; cpu < NR_CPUS; cpu++) {
+        rq = cpu_rq(cpu);
+        for (g = 0; g < MAX_GROUPS; g++) {
+            for (i = 0; i < PRIO_LEVELS; i++) {
+                iqueue_init(&rq->fair.groups[g].ready[i]);
+            }
+            for (i = 0; i < PRIO_BITMAP_WORDS; i++) {
+                rq->fair.groups[g].bitmap[i] = 0;
+            }
+            rq->fair.groups[g].nr_queued = 0;
+            rq->fair.groups[g].vruntime = 0;
+        }
+        rq->fair.slice = FAIR_MIN_GRANULARITY;
+        rq->fair.min_vruntime = 0;
+        iqueue_init(&rq->fair.gang_ready);
+        rq->fair.active_gang = GANG_NONE;
+        rq->fair.gang_expires = 0;
+    }
+    
+    /* Only the root group exists at boot */
+    for (g = 0; g < MAX_GROUPS; g++) {
+        group_reset(&group_table[g], GROUP_WEIGHT_DEFAULT);
+    }
+    group_table[ROOT_GROUP].used = 1;
+    
+    for (g = 0; g < MAX_GANGS; g++) {
+        gang_table[g].used = 0;
+        gang_table[g].nr_members = 0;
+        gang_table[g].nr_slices = 0;
+    }
+}
+
+/* New threads belong to their creator's group and to no gang */
+void fair_fork(pcb_t *pcb, pcb_t *parent) {
+    pcb_ext_t *ext = pcb_ext(pcb);
+    
+    ext->group = (parent != NULL) ? pcb_ext(parent)->group : ROOT_GROUP;
+    ext->gang = GANG_NONE;
+    group_table[ext->group].nr_members++;
+}
+
+/* Drop a freed process's group and gang membership */
+void fair_exit(pcb_t *pcb) {
+    pcb_ext_t *ext = pcb_ext(pcb);
+    
+    group_table[ext->group].nr_members--;
+    if (ext->gang != GANG_NONE) {
+        gang_table[ext->gang].nr_members--;
+        ext->gang = GANG_NONE;
+    }
+}
+
+/* ========== SYSTEM CALLS ========== */
+
+/* Create a thread group with the given CPU share, return its id or -1 */
+int do_group_create(int weight) {
+    int g, cpu;
+    
+    if (weight < GROUP_WEIGHT_MIN || weight > GROUP_WEIGHT_MAX) {
+        return -1;
+    }
+    
+    enter_critical();
+    
+    for (g = 0; g < MAX_GROUPS; g++) {
+        if (!group_table[g].used) {
+            group_reset(&group_table[g], weight);
+            group_table[g].used = 1;
+            for (cpu = 0; cpu < NR_CPUS; cpu++) {
+                cpu_rq(cpu)->fair.groups[g].vruntime = cpu_rq(cpu)->fair.min_vruntime;
+            }
+            
+            leave_critical();
+            return g;
+        }
+    }
+    
+    leave_critical();
+    return -1; /* No free groups */
+}
+
+/* Destroy an empty thread group */
+int do_group_destroy(int gid) {
+    int result = -1;
+    
+    if (gid <= ROOT_GROUP || gid >= MAX_GROUPS) {
+        return -1;
+    }
+    
+    enter_critical();
+    
+    if (group_table[gid].used && group_table[gid].nr_members == 0) {
+        group_table[gid].used = 0;
+        result = 0;
+    }
+    
+    leave_critical();
+    return result;
+}
+
+/* Change the CPU share of a thread group */
+int do_group_setweight(int gid, int weight) {
+    int result = -1;
+    
+    if (gid < 0 || gid >= MAX_GROUPS ||
+        weight < GROUP_WEIGHT_MIN || weight > GROUP_WEIGHT_MAX) {
+        return -1;
+    }
+    
+    enter_critical();
+    
+    if (group_table[gid].used) {
+        group_table[gid].weight = weight;
+        group_table[gid].inv_weight = GROUP_VRUNTIME_SCALE / weight;
+        result = 0;
+    }
+    
+    leave_critical();
+    return result;
+}
+
+/* Cap a group at quota ticks per period ticks (GROUP_QUOTA_UNLIMITED lifts it) */
+int do_group_setquota(int gid, int quota, int period) {
+    sched_group_t *grp;
+    
+    if (gid < 0 || gid >= MAX_GROUPS || quota < 0 ||
+        period < 1 || quota > period) {
+        return -1;
+    }
+    
+    enter_critical();
+    
+    grp = &group_table[gid];
+    if (!grp->used) {
+        leave_critical();
+        return -1;
+    }
+    
+    /* A member running with its tick stopped must be capped from now on */
+    if (quota != GROUP_QUOTA_UNLIMITED) {
+        restart_ticks(gid, NULL);
+    }
+    
+    /* Close any throttled interval, then start a fresh period */
+    if (grp->throttled) {
+        grp->throttled = 0;
+        grp->throttled_time += time_elapsed - grp->throttled_since;
+        kick_idle_cpus();
+    }
+    grp->quota = quota;
+    grp->period = period;
+    grp->runtime = 0;
+    grp->period_start = time_elapsed;
+    
+    leave_critical();
+    return 0;
+}
+
+/* Nonzero if a running process has a quota or gang slice to enforce */
+int fair_needs_tick(pcb_t *pcb) {
+    pcb_ext_t *ext = pcb_ext(pcb);
+    
+    return ext->gang != GANG_NONE ||
+           group_table[ext->group].quota != GROUP_QUOTA_UNLIMITED;
+}
+
+/* Total ticks a group has spent throttled, returns -1 for a bad group id */
+int do_group_throttled_time(int gid, uint64_t *ticks) {
+    sched_group_t *grp;
+    
+    if (gid < 0 || gid >= MAX_GROUPS || ticks == NULL) {
+        return -1;
+    }
+    
+    enter_critical();
+    
+    grp = &group_table[gid];
+    if (!grp->used) {
+        leave_critical();
+        return -1;
+    }
+    
+    *ticks = grp->throttled_time;
+    if (grp->throttled) {
+        *ticks += time_elapsed - grp->throttled_since;
+    }
+    
+    leave_critical();
+    return 0;
+}
+
+/* Set the fair target latency in ticks, 0 for a fixed one-tick quantum */
+int do_sched_setlatency(int ticks) {
+    int cpu;
+    
+    if (ticks < 0) {
+        return -1;
+    }
+    
+    enter_critical();
+    
+    sched_latency = ticks;
+    for (cpu = 0; cpu < NR_CPUS; cpu++) {
+        update_slice(cpu_rq(cpu));
+    }
+    
+    leave_critical();
+    return 0;
+}
+
+/* Current fair target latency in ticks (0 when the quantum is fixed) */
+int do_sched_getlatency(void) {
+    return sched_latency;
+}
+
+/* Move a process into another thread group (pid 0 means the caller) */
+int do_group_move(int pid, int gid) {
+    pcb_t *pcb;
+    pcb_ext_t *ext;
+    
+    if (gid < 0 || gid >= MAX_GROUPS) {
+        return -1;
+    }
+    
+    enter_critical();
+    
+    pcb = (pid == 0) ? current_running : get_process_by_pid(pid);
+    if (pcb == NULL || !group_table[gid].used) {
+        leave_critical();
+        return -1;
+    }
+    
+    ext = pcb_ext(pcb);
+    if (ext->group != gid) {
+        if (group_table[gid].quota != GROUP_QUOTA_UNLIMITED) {
+            restart_ticks(gid, pcb);
+        }
+        group_table[ext->group].nr_members--;
+        group_table[gid].nr_members++;
+        
+        if (pcb->status == PROCESS_READY) {
+            sched_dequeue(pcb);
+            ext->group = gid;
+            sched_enqueue(pcb);
+        } else {
+            ext->group = gid;
+        }
+    }
+    
+    leave_critical();
+    return 0;
+}
+
+/* Create an empty gang, return its id or -1 */
+int do_gang_create(void) {
+    int g;
+    
+    enter_critical();
+    
+    for (g = 0; g < MAX_GANGS; g++) {
+        if (!gang_table[g].used) {
+            gang_table[g].used = 1;
+            gang_table[g].nr_members = 0;
+            gang_table[g].nr_slices = 0;
+            
+            leave_critical();
+            return g;
+        }
+    }
+    
+    leave_critical();
+    return -1; /* No free gangs */
+}
+
+/* Destroy an empty gang */
+int do_gang_destroy(int gang) {
+    int result = -1;
+    
+    if (gang < 0 || gang >= MAX_GANGS) {
+        return -1;
+    }
+    
+    enter_critical();
+    
+    if (gang_table[gang].used && gang_table[gang].nr_members == 0) {
+        gang_table[gang].used = 0;
+        result = 0;
+    }
+    
+    leave_critical();
+    return result;
+}
+
+/* Add a process to a gang, or remove it with GANG_NONE (pid 0 means the caller) */
+int do_gang_join(int pid, int gang) {
+    pcb_t *pcb;
+    pcb_ext_t *ext;
+    
+    if (gang != GANG_NONE && (gang < 0 || gang >= MAX_GANGS)) {
+        return -1;
+    }
+    
+    enter_critical();
+    
+    pcb = (pid == 0) ? current_running : get_process_by_pid(pid);
+    if (pcb == NULL || (gang != GANG_NONE && !gang_table[gang].used)) {
+        leave_critical();
+        return -1;
+    }
+    
+    ext = pcb_ext(pcb);
+    if (ext->gang != gang) {
+        if (gang != GANG_NONE) {
+            restart_ticks(ext->group, pcb);
+        }
+        if (ext->gang != GANG_NONE) {
+            gang_table[ext->gang].nr_members--;
+        }
+        if (gang != GANG_NONE) {
+            gang_table[gang].nr_members++;
+        }
+        
+        /* Leave any gang queue before the membership changes */
+        if (pcb->status == PROCESS_READY) {
+            sched_dequeue(pcb);
+            ext->gang = gang;
+            sched_enqueue(pcb);
+        } else {
+            ext->gang = gang;
+        }
+    }
+    
+    leave_critical();
+    return 0;
+}
@@ -0,0 +1,208 @@
+/* sched_rt.c - Real-time scheduling classes: SCHED_FIFO and SCHED_RR */
+
+#include "scheduler.h"
+#include "sched_ext.h"
+#include "sched_class.h"
+#include "queue.h"
+#include "common.h"
+
+/* The fair-only variant has no real-time classes */
+#if !CONFIG_SCHED_FAIR_ONLY
+
+/* External declarations from entry.S */
+extern uint64_t time_elapsed;
+
+/* ========== CLASS OPERATIONS ========== */
+
+static void rt_enqueue(rq_t *rq, pcb_t *pcb, int flags) {
+    pcb_ext_t *ext = pcb_ext(pcb);
+    iqueue_t *queue = &rq->rt.queues[ext->rt_priority];
+    
+    /* A preempted process keeps its place at the head of its priority,
+     * unless it is SCHED_RR and used up its quantum */
+    if ((flags & ENQUEUE_PREEMPTED) &&
+        (ext->policy == SCHED_FIFO || ext->slice > 0)) {
+        rq_queue_push(queue, pcb);
+    } else {
+        if (ext->slice <= 0) {
+            ext->slice = RT_RR_TIMESLICE;
+        }
+        rq_queue_put(queue, pcb);
+    }
+    
+    prio_bitmap_set(rq->rt.bitmap, ext->rt_priority);
+    rq->rt.nr_running++;
+}
+
+static void rt_dequeue(rq_t *rq, pcb_t *pcb) {
+    int prio = pcb_ext(pcb)->rt_priority;
+    
+    if (rq_queue_remove(&rq->rt.queues[prio], pcb)) {
+        rq->rt.nr_running--;
+        if (iqueue_empty(&rq->rt.queues[prio])) {
+            prio_bitmap_clear(rq->rt.bitmap, prio);
+        }
+    }
+}
+
+static pcb_t* rt_pick_next(rq_t *rq) {
+    pcb_t *pcb;
+    int prio;
+    
+    /* Over budget for this period: let the lower classes run */
+    if (rq->rt.throttled) {
+        return NULL;
+    }
+    
+    prio = prio_bitmap_highest(rq->rt.bitmap, RT_BITMAP_WORDS);
+    if (prio < 0) {
+        return NULL;
+    }
+    
+    pcb = rq_queue_get(&rq->rt.queues[prio]);
+    rq->rt.nr_running--;
+    if (iqueue_empty(&rq->rt.queues[prio])) {
+        prio_bitmap_clear(rq->rt.bitmap, prio);
+    }
+    
+    return pcb;
+}
+
+static void rt_tick(rq_t *rq, pcb_t *curr) {
+    rt_rq_t *rt = &rq->rt;
+    pcb_ext_t *ext;
+    
+    /* New period: replenish the real-time budget */
+    if (time_elapsed - rt->period_start >= RT_PERIOD) {
+        rt->period_start = time_elapsed;
+        rt->rt_time = 0;
+        if (rt->throttled) {
+            rt->throttled = 0;
+            rq->need_resched = 1;
+        }
+    }
+    
+    if (curr == NULL) {
+        return;
+    }
+    
+    if (++rt->rt_time >= RT_RUNTIME && !rt->throttled) {
+        rt->throttled = 1;
+        rq->need_resched = 1;
+    }
+    
+    /* SCHED_RR rotates when its quantum runs out, SCHED_FIFO never does */
+    ext = pcb_ext(curr);
+    if (ext->policy == SCHED_RR && --ext->slice <= 0) {
+        ext->slice = 0;
+        rq->need_resched = 1;
+    }
+}
+
+/* rt_tick() for every tick after from up to upto at once: only the
+ * ticks since the last period boundary crossed count against the budget */
+static void rt_catch_up(rq_t *rq, pcb_t *curr, uint64_t from, uint64_t upto) {
+    rt_rq_t *rt = &rq->rt;
+    pcb_ext_t *ext;
+    uint64_t first = rt->period_start + RT_PERIOD, last;
+    uint64_t ran = upto - from;
+    
+    if (first <= from) {
+        first = from + 1;
+    }
+    if (first <= upto) {
+        /* A budget used up before the last boundary, in the first period
+         * or in any whole one, was throttled and replenished on the way */
+        last = period_last(first, upto, RT_PERIOD);
+        if (curr != NULL &&
+            (last > first || rt->rt_time + (first - from - 1) >= RT_RUNTIME)) {
+            rt->throttled = 1;
+        }
+        rt->period_start = last;
+        rt->rt_time = 0;
+        if (rt->throttled) {
+            rt->throttled = 0;
+            rq->need_resched = 1;
+        }
+        ran = upto - rt->period_start + 1;
+    }
+    
+    if (curr == NULL) {
+        return;
+    }
+    
+    rt->rt_time += (int)ran;
+    if (rt->rt_time >= RT_RUNTIME && !rt->throttled) {
+        rt->throttled = 1;
+        rq->need_resched = 1;
+    }
+    
+    ext = pcb_ext(curr);
+    if (ext->policy == SCHED_RR) {
+        if (ext->slice <= 0 || (uint64_t)ext->slice <= upto - from) {
+            ext->slice = 0;
+            rq->need_resched = 1;
+        } else {
+            ext->slice -= (int)(upto - from);
+        }
+    }
+}
+
+static void rt_yield(rq_t *rq, pcb_t *curr) {
+    /* Back to the tail of its priority level with a fresh quantum */
+    pcb_ext(curr)->slice = 0;
+    rt_enqueue(rq, curr, 0);
+}
+
+static void rt_wakeup(rq_t *rq, pcb_t *pcb) {
+    pcb_t *curr = get_current_process();
+    
+    /* A higher static priority preempts the running real-time process */
+    if (curr != NULL && curr->status == PROCESS_RUNNING &&
+        pcb_ext(curr)->sched_class == &rt_sched_class &&
+        pcb_ext(curr)->cpu == rq->cpu &&
+        pcb_ext(pcb)->rt_priority > pcb_ext(curr)->rt_priority) {
+        rq->need_resched = 1;
+    }
+}
+
+static int rt_nr_running(rq_t *rq) {
+    return rq->rt.nr_running;
+}
+
+const sched_class_t rt_sched_class = {
+    .name       = "rt",
+    .next       = &fair_sched_class,
+    .enqueue    = rt_enqueue,
+    .dequeue    = rt_dequeue,
+    .pick_next  = rt_pick_next,
+    .tick       = rt_tick,
+    .catch_up   = rt_catch_up,
+    .yield      = rt_yield,
+    .wakeup     = rt_wakeup,
+    .nr_running = rt_nr_running,
+};
+
+/* ========== SETUP ========== */
+
+/* Set up the per-CPU real-time queues */
+void rt_init(void) {
+    rq_t *rq;
+    int cpu, i;
+    
+    for (cpu = 0; cpu < NR_CPUS; cpu++) {
+        rq = cpu_rq(cpu);
+        for (i = 0; i < RT_PRIO_LEVELS; i++) {
+            iqueue_init(&rq->rt.queues[i]);
+        }
+        for (i = 0; i < RT_BITMAP_WORDS; i++) {
+            rq->rt.bitmap[i] = 0;
+        }
+        rq->rt.nr_running = 0;
+        rq->rt.rt_time = 0;
+        rq->rt.period_start = 0;
+        rq->rt.throttled = 0;
+    }
+}
+
+#endif /* !CONFIG_SCHED_FAIR_ONLY */
@@ -1,6 +1,11 @@
 /* scheduler.c - Complete process scheduler implementation */
 
 #include "scheduler.h"
+#include "sched_ext.h"
+#include "sched_class.h"
+#include "wait.h"
+#include "handle.h"
+#include "idle.h"
 #include "queue.h"
 #include "util.h"
 #include "interrupt.h"
@@ -10,22 +15,436 @@
 extern uint64_t time_elapsed;
 extern int disable_count;
 
-/* Ready queue for runnable processes */
-queue_t ready_queue;
+/* Per-CPU run queues for runnable processes */
+static rq_t runqueues[NR_CPUS];
 
-/* Sleeping queue for blocked processes */
-queue_t sleeping_queue;
+/* Sleeping processes and their wakeup times as a dense struct of
+ * arrays, so check_sleeping() scans one array instead of chasing PCB
+ * links: entry i belongs to process slot sleep_slot[i] */
+static uint32_t sleep_wake[MAX_PROCESSES];
+static int sleep_slot[MAX_PROCESSES];
+static int nr_sleepers;
+
+/* CPUs that stop their tick while running a single process */
+static cpumask_t nohz_full_mask;
+
+/* Earliest sleep deadline while some CPU has its tick stopped; may be
+ * early after a sleeper leaves, never late */
+static uint64_t nohz_next_event;
 
 /* Current running process */
 pcb_t *current_running = NULL;
 
+/* Stands in for current_running while a CPU idles: never RUNNING, so
+ * nothing charges or preempts it, and nested, so irq0 only serves the
+ * sleepers and never switches away from it */
+static pcb_t idle_pcb[NR_CPUS];
+
 /* Process table */
 static pcb_t process_table[MAX_PROCESSES];
-static int next_pid = 1;
+
+/* Free process slots, two levels: bit s of free_slot_map[w] is slot
+ * 32 * w + s, bit w of free_slot_summary is set if word w has any */
+static uint32_t free_slot_map[SLOT_MAP_WORDS];
+static uint32_t free_slot_summary;
+
+/* Generation of each slot, bumped on free; a PID is
+ * (generation << PID_SLOT_BITS) | slot, so PIDs are reused only after
+ * PID_GEN_MAX lifetimes of a slot and never overflow */
+static uint32_t pid_gen[MAX_PROCESSES];
+
+/* One summary word covers 32 map words, the PID holds the slot */
+#if MAX_PROCESSES > 32 * 32 || MAX_PROCESSES > (1 << PID_SLOT_BITS)
+#error "MAX_PROCESSES too large for the slot bitmap or PID layout"
+#endif
+
+/* Scheduling state parallel to process_table */
+static pcb_ext_t pcb_ext_table[MAX_PROCESSES];
+
+/* Class run queue links parallel to process_table */
+ilink_t rq_links[MAX_PROCESSES];
+
+#if CONFIG_SMP
+/* CPU id of the caller; only the boot CPU runs until SMP bring-up */
+int this_cpu(void) {
+    return 0;
+}
+#endif
+
+/* Get the process table index of a PCB */
+int pcb_slot(pcb_t *pcb) {
+    return pcb - process_table;
+}
+
+/* Get the scheduling state of a PCB */
+pcb_ext_t* pcb_ext(pcb_t *pcb) {
+    return &pcb_ext_table[pcb - process_table];
+}
+
+/* Get the run queue of a CPU */
+rq_t* cpu_rq(int cpu) {
+    return &runqueues[cpu];
+}
+
+#if !CONFIG_SCHED_FAIR_ONLY
+/* Scheduling classes in precedence order, linked through ->next */
+const sched_class_t *const sched_class_highest = &rt_sched_class;
+#endif
+
+/* Get a process table entry by index */
+pcb_t* process_slot(int slot) {
+    return &process_table[slot];
+}
 
 /* Helper function to get ready queue (needed by sync.c) */
 queue_t* get_ready_queue(void) {
-    return &ready_queue;
+    return &runqueues[this_cpu()].inbox;
+}
+
+/* Nonzero if class a takes precedence over class b */
+static int sched_class_above(const sched_class_t *a, const sched_class_t *b) {
+    const sched_class_t *class;
+    
+    for (class = sched_class_highest; class != NULL; class = sched_class_next(class)) {
+        if (class == b) {
+            return 0;
+        }
+        if (class == a) {
+            return 1;
+        }
+    }
+    
+    return 0;
+}
+
+/* Number of runnable processes queued on a CPU, over all classes */
+int rq_nr_running(rq_t *rq) {
+    const sched_class_t *class;
+    int count = queue_size(&rq->inbox);
+    
+    for (class = sched_class_highest; class != NULL; class = sched_class_next(class)) {
+        count += sched_call(class, nr_running)(rq);
+    }
+    
+    return count;
+}
+
+/* Choose the run queue for a process that is becoming runnable */
+static int select_task_rq(pcb_t *pcb) {
+    pcb_ext_t *ext = pcb_ext(pcb);
+    int cpu, load;
+    int best = -1, best_load = 0;
+    
+    /* Stay on the previous CPU while allowed, its cache is still warm */
+    if (!CONFIG_SMP || (ext->affinity & cpu_mask(ext->cpu))) {
+        return ext->cpu;
+    }
+    
+    /* Otherwise take the least loaded allowed CPU */
+    for (cpu = 0; cpu < NR_CPUS; cpu++) {
+        if (!(ext->affinity & cpu_mask(cpu))) {
+            continue;
+        }
+        load = rq_nr_running(&runqueues[cpu]);
+        if (best < 0 || load < best_load) {
+            best = cpu;
+            best_load = load;
+        }
+    }
+    
+    return best;
+}
+
+/* Estimated cost, in queued-process units, of moving a process off the
+ * CPU it last ran on: nonzero only while its cache there is still hot */
+static int migration_cost(pcb_t *pcb) {
+    if (time_elapsed - pcb_ext(pcb)->last_ran < CACHE_HOT_TICKS) {
+        return MIGRATION_COST;
+    }
+    return 0;
+}
+
+/* Choose the run queue for a woken process: its previous CPU, the waker's
+ * CPU or an idle CPU, whichever gets it running soonest once the cost of
+ * leaving a hot cache is added. Ties go to the waker, which has just
+ * touched the data being handed over. */
+static int select_task_rq_wake(pcb_t *pcb, int waker) {
+    pcb_ext_t *ext = pcb_ext(pcb);
+    rq_t *rq = &runqueues[waker];
+    int prev = ext->last_cpu;
+    int cost = migration_cost(pcb);
+    int cpu, load;
+    int best = -1, best_cost = 0;
+    
+    if (!CONFIG_SMP) {
+        schedstat_inc(rq->nr_wake_prev);
+        return 0;
+    }
+    
+    if (ext->affinity & cpu_mask(waker)) {
+        best = waker;
+        best_cost = rq_nr_running(&runqueues[waker]) + (waker != prev ? cost : 0);
+    }
+    
+    if ((ext->affinity & cpu_mask(prev)) && prev != waker) {
+        load = rq_nr_running(&runqueues[prev]);
+        if (best < 0 || load < best_cost) {
+            best = prev;
+            best_cost = load;
+        }
+    }
+    
+    /* An idle allowed CPU beats both if the migration is worth it */
+    for (cpu = 0; cpu < NR_CPUS && best_cost > cost; cpu++) {
+        if ((ext->affinity & cpu_mask(cpu)) && cpu != prev &&
+            rq_nr_running(&runqueues[cpu]) == 0) {
+            best = cpu;
+            best_cost = cost;
+        }
+    }
+    
+    if (best < 0) {
+        best = select_task_rq(pcb);
+    } else if (best == prev) {
+        schedstat_inc(rq->nr_wake_prev);
+    } else if (best == waker) {
+        schedstat_inc(rq->nr_wake_affine);
+    } else {
+        schedstat_inc(rq->nr_wake_idle);
+    }
+    
+    return best;
+}
+
+static void tick_nohz_restart(rq_t *rq, uint64_t upto);
+
+/* Place a process on the run queue of a CPU it is allowed to run on */
+static void place_ready(pcb_t *pcb, int cpu, int flags) {
+    pcb_ext_t *ext = pcb_ext(pcb);
+    
+    /* A second runnable process needs the tick to share the CPU */
+    tick_nohz_restart(&runqueues[cpu], time_elapsed);
+    
+    ext->cpu = cpu;
+    pcb->status = PROCESS_READY;
+    sched_call(ext->sched_class, enqueue)(&runqueues[cpu], pcb, flags);
+    
+    /* cpu_idle() waits for this write; in MWAIT it alone wakes the CPU */
+    if (runqueues[cpu].in_idle) {
+        runqueues[cpu].need_resched = 1;
+    }
+}
+
+/* Let a CPU see class state changed outside place_ready() */
+void resched_cpu(int cpu) {
+    tick_nohz_restart(&runqueues[cpu], time_elapsed);
+    runqueues[cpu].need_resched = 1;
+}
+
+/* Put a process that was not blocked back on a run queue */
+void sched_enqueue(pcb_t *pcb) {
+    place_ready(pcb, select_task_rq(pcb), 0);
+}
+
+/* Take a ready process off the run queue that holds it */
+void sched_dequeue(pcb_t *pcb) {
+    pcb_ext_t *ext = pcb_ext(pcb);
+    
+    sched_call(ext->sched_class, dequeue)(&runqueues[ext->cpu], pcb);
+}
+
+/* Decide whether a newly queued process should preempt the running one */
+static void check_preempt(pcb_t *pcb) {
+    pcb_ext_t *ext = pcb_ext(pcb);
+    
+    /* A process of a higher class always preempts; within the same
+     * class the class's wakeup hook decides */
+    if (current_running != NULL && current_running->status == PROCESS_RUNNING &&
+        pcb_ext(current_running)->cpu == ext->cpu &&
+        sched_class_above(ext->sched_class, pcb_ext(current_running)->sched_class)) {
+        runqueues[ext->cpu].need_resched = 1;
+    } else if (ext->sched_class->wakeup != NULL) {
+        ext->sched_class->wakeup(&runqueues[ext->cpu], pcb);
+    }
+}
+
+/* Make a blocked process runnable on the best CPU for a wakeup */
+static void wake_up_process(pcb_t *pcb) {
+    int waker = this_cpu();
+    
+    schedstat_inc(runqueues[waker].nr_wakeups);
+    place_ready(pcb, select_task_rq_wake(pcb, waker), 0);
+    check_preempt(pcb);
+}
+
+/* Place the processes sync.c queued on a CPU's inbox through
+ * get_ready_queue(), behind the scheduler's back */
+static void drain_inbox(rq_t *rq) {
+    pcb_t *pcb;
+    
+    while ((pcb = (pcb_t *)queue_get(&rq->inbox)) != NULL) {
+        wake_up_process(pcb);
+    }
+}
+
+/* Record that a process is about to run on a CPU */
+static void note_dispatch(rq_t *rq, pcb_ext_t *ext, int cpu) {
+    if (CONFIG_SMP && ext->last_cpu != cpu) {
+        schedstat_inc(rq->nr_migrations);
+    }
+    ext->cpu = cpu;
+    ext->last_cpu = cpu;
+}
+
+/* Remove the next process to run on a CPU, or NULL if none may run */
+static pcb_t* pick_next_task(int cpu) {
+    rq_t *rq = &runqueues[cpu];
+    const sched_class_t *class;
+    pcb_t *pcb;
+    
+    /* The process the tick was stopped for is giving up the CPU */
+    tick_nohz_restart(rq, time_elapsed);
+    
+    /* Processes queued behind the scheduler's back get placed properly */
+    drain_inbox(rq);
+    
+    /* The first class in precedence order with a runnable process wins */
+    for (class = sched_class_highest; class != NULL; class = sched_class_next(class)) {
+        pcb = sched_call(class, pick_next)(rq);
+        if (pcb != NULL) {
+            rq->need_resched = 0;
+            note_dispatch(rq, pcb_ext(pcb), cpu);
+            return pcb;
+        }
+    }
+    
+    return NULL;
+}
+
+/* Remove the next process to run on a CPU, idling until there is one
+ * (on the kernel stack of the process the CPU is leaving) */
+static pcb_t* pick_next_or_idle(int cpu) {
+    rq_t *rq = &runqueues[cpu];
+    pcb_t *next;
+    
+    /* Every wakeup from here on sets need_resched, so none is missed
+     * between a pick that finds nothing and the idle loop */
+    rq->in_idle = 1;
+    for (;;) {
+        rq->need_resched = 0;
+        next = pick_next_task(cpu);
+        if (next != NULL) {
+            break;
+        }
+        current_running = &idle_pcb[cpu];
+        cpu_idle();
+    }
+    rq->in_idle = 0;
+    
+    return next;
+}
+
+/* Pass one tick to every scheduling class */
+static void class_tick(rq_t *rq, pcb_t *curr) {
+    const sched_class_t *class;
+    
+    for (class = sched_class_highest; class != NULL; class = sched_class_next(class)) {
+        sched_call(class, tick)(rq, (curr != NULL && pcb_ext(curr)->sched_class == class) ?
+                                curr : NULL);
+    }
+}
+
+/* Nonzero if curr is alone on its CPU and nothing it runs under needs
+ * enforcing on a tick boundary */
+static int tick_nohz_can_stop(rq_t *rq, pcb_t *curr) {
+    pcb_ext_t *ext = pcb_ext(curr);
+    
+    if (!(nohz_full_mask & cpu_mask(rq->cpu)) || rq->need_resched ||
+        rq_nr_running(rq) != 0) {
+        return 0;
+    }
+    
+    return ext->sched_class != &fair_sched_class || !fair_needs_tick(curr);
+}
+
+/* Stop the class ticks of a CPU until the next sleep deadline, another
+ * runnable process or a reschedule */
+static void tick_nohz_stop(rq_t *rq, pcb_t *curr) {
+    int i;
+    int32_t delta, next = 0x7fffffff;
+    
+    for (i = 0; i < nr_sleepers; i++) {
+        delta = (int32_t)(sleep_wake[i] - (uint32_t)time_elapsed);
+        if (delta < next) {
+            next = delta;
+        }
+    }
+    nohz_next_event = time_elapsed + (next > 0 ? next : 0);
+    
+    rq->tick_stopped = 1;
+    rq->tick_stopped_at = time_elapsed;
+    rq->tick_curr = curr;
+}
+
+/* Restart the class ticks of a CPU, first charging the process it ran
+ * with every tick skipped up to and including tick upto, so quotas,
+ * vruntime and real-time budgets come out as if it had never stopped.
+ * Each class does so in closed form, however long the tick was off. */
+static void tick_nohz_restart(rq_t *rq, uint64_t upto) {
+    const sched_class_t *class;
+    pcb_t *curr = rq->tick_curr;
+    
+    if (!rq->tick_stopped) {
+        return;
+    }
+    rq->tick_stopped = 0;
+    rq->tick_curr = NULL;
+    
+    if (upto <= rq->tick_stopped_at) {
+        return;
+    }
+    for (class = sched_class_highest; class != NULL; class = sched_class_next(class)) {
+        sched_call(class, catch_up)(rq, pcb_ext(curr)->sched_class == class ? curr : NULL,
+                                    rq->tick_stopped_at, upto);
+    }
+    pcb_ext(curr)->last_ran = upto;
+}
+
+/* Pass the current tick to every scheduling class */
+void scheduler_tick(void) {
+    pcb_t *curr = NULL;
+    rq_t *rq = &runqueues[this_cpu()];
+    int restarted = 0;
+    
+    enter_critical();
+    
+    /* Nohz-full: the tick only has to notice the next sleep deadline
+     * and inbox wakeups, which do not pass through place_ready() */
+    if (rq->tick_stopped) {
+        if (time_elapsed < nohz_next_event && queue_empty(&rq->inbox)) {
+            leave_critical();
+            return;
+        }
+        tick_nohz_restart(rq, time_elapsed - 1);
+        restarted = 1;
+        drain_inbox(rq);
+    }
+    
+    if (current_running != NULL && current_running->status == PROCESS_RUNNING) {
+        curr = current_running;
+        pcb_ext(curr)->last_ran = time_elapsed;
+    }
+    
+    class_tick(rq, curr);
+    
+    /* The deadline that restarted the tick is served by check_sleeping()
+     * later in this interrupt, which a stopped tick would skip; stop
+     * again no earlier than the next tick */
+    if (curr != NULL && !restarted && tick_nohz_can_stop(rq, curr)) {
+        tick_nohz_stop(rq, curr);
+    }
+    
+    leave_critical();
 }
 
 /* Initialize the scheduler */
@@ -33,8 +452,49 @@ void scheduler_init(void) {
     int i;
     
     /* Initialize queues */
-    queue_init(&ready_queue);
-    queue_init(&sleeping_queue);
+    for (i = 0; i < NR_CPUS; i++) {
+        runqueues[i].cpu = i;
+        runqueues[i].need_resched = 0;
+        queue_init(&runqueues[i].inbox);
+        runqueues[i].nr_wakeups = 0;
+        runqueues[i].nr_wake_prev = 0;
+        runqueues[i].nr_wake_affine = 0;
+        runqueues[i].nr_wake_idle = 0;
+        runqueues[i].nr_migrations = 0;
+        runqueues[i].tick_stopped = 0;
+        runqueues[i].tick_stopped_at = 0;
+        runqueues[i].tick_curr = NULL;
+        runqueues[i].in_idle = 0;
+        idle_pcb[i].pid = 0;
+        idle_pcb[i].status = PROCESS_BLOCKED;
+        idle_pcb[i].priority = DEFAULT_PRIORITY;
+        idle_pcb[i].nested_count = 1;
+        idle_pcb[i].wakeup_time = 0;
+        idle_pcb[i].kernel_stack_top = 0;
+    }
+    nr_sleepers = 0;
+    nohz_full_mask = CPU_MASK_NONE;
+    nohz_next_event = 0;
+#if !CONFIG_SCHED_FAIR_ONLY
+    rt_init();
+#endif
+    fair_init();
+#if !CONFIG_SCHED_FAIR_ONLY
+    bg_init();
+#endif
+    handle_init();
+    idle_init();
+    
+    /* Every slot starts free */
+    for (i = 0; i < SLOT_MAP_WORDS; i++) {
+        free_slot_map[i] = 0;
+    }
+    free_slot_summary = 0;
+    for (i = 0; i < MAX_PROCESSES; i++) {
+        free_slot_map[i >> 5] |= (uint32_t)1 << (i & 31);
+        free_slot_summary |= (uint32_t)1 << (i >> 5);
+        pid_gen[i] = 1;
+    }
     
     /* Initialize process table */
     for (i = 0; i < MAX_PROCESSES; i++) {
@@ -44,6 +504,23 @@ void scheduler_init(void) {
         process_table[i].nested_count = 0;
         process_table[i].wakeup_time = 0;
         process_table[i].kernel_stack_top = 0;
+        pcb_ext_table[i].sched_class = &fair_sched_class;
+        pcb_ext_table[i].policy = SCHED_NORMAL;
+        pcb_ext_table[i].rt_priority = 0;
+        pcb_ext_table[i].slice = 0;
+        pcb_ext_table[i].affinity = CPU_MASK_ALL;
+        pcb_ext_table[i].cpu = 0;
+        pcb_ext_table[i].group = ROOT_GROUP;
+        pcb_ext_table[i].gang = GANG_NONE;
+        pcb_ext_table[i].last_cpu = 0;
+        pcb_ext_table[i].last_ran = 0;
+        pcb_ext_table[i].level = 0;
+        pcb_ext_table[i].aged_at = 0;
+        pcb_ext_table[i].wait_nr = 0;
+        pcb_ext_table[i].wait_result = 0;
+        pcb_ext_table[i].sleep_index = -1;
+        rq_links[i].prev = IQ_NONE;
+        rq_links[i].next = IQ_NONE;
     }
     
     current_running = NULL;
@@ -51,36 +528,62 @@ void scheduler_init(void) {
 
 /* Allocate a new PCB from process table */
 pcb_t* pcb_allocate(void) {
-    int i;
+    int w, i;
     
     enter_critical();
     
-    for (i = 0; i < MAX_PROCESSES; i++) {
-        if (process_table[i].status == PROCESS_FREE) {
-            process_table[i].pid = next_pid++;
-            process_table[i].status = PROCESS_READY;
-            process_table[i].priority = DEFAULT_PRIORITY;
-            process_table[i].nested_count = 0;
-            process_table[i].wakeup_time = 0;
-            
-            leave_critical();
-            return &process_table[i];
-        }
+    if (free_slot_summary == 0) {
+        leave_critical();
+        return NULL; /* No free PCBs */
+    }
+    
+    /* Lowest free slot: one bit scan per level */
+    w = __builtin_ctz(free_slot_summary);
+    i = (w << 5) + __builtin_ctz(free_slot_map[w]);
+    free_slot_map[w] &= free_slot_map[w] - 1;
+    if (free_slot_map[w] == 0) {
+        free_slot_summary &= ~((uint32_t)1 << w);
     }
     
+    process_table[i].pid = (int)(pid_gen[i] << PID_SLOT_BITS) | i;
+    process_table[i].status = PROCESS_READY;
+    process_table[i].priority = DEFAULT_PRIORITY;
+    process_table[i].nested_count = 0;
+    process_table[i].wakeup_time = 0;
+    pcb_ext_table[i].sched_class = &fair_sched_class;
+    pcb_ext_table[i].policy = SCHED_NORMAL;
+    pcb_ext_table[i].rt_priority = 0;
+    pcb_ext_table[i].slice = 0;
+    pcb_ext_table[i].affinity = CPU_MASK_ALL;
+    pcb_ext_table[i].cpu = this_cpu();
+    pcb_ext_table[i].last_cpu = this_cpu();
+    pcb_ext_table[i].last_ran = 0;
+    pcb_ext_table[i].wait_nr = 0;
+    pcb_ext_table[i].sleep_index = -1;
+    fair_fork(&process_table[i], current_running);
+    
     leave_critical();
-    return NULL; /* No free PCBs */
+    return &process_table[i];
 }
 
 /* Free a PCB */
 void pcb_free(pcb_t *pcb) {
+    int i;
+    
     if (pcb == NULL) {
         return;
     }
     
     enter_critical();
+    fair_exit(pcb);
     pcb->status = PROCESS_FREE;
     pcb->pid = 0;
+    
+    /* Retire the PID and hand the slot back */
+    i = pcb - process_table;
+    pid_gen[i] = pid_gen[i] < PID_GEN_MAX ? pid_gen[i] + 1 : 1;
+    free_slot_map[i >> 5] |= (uint32_t)1 << (i & 31);
+    free_slot_summary |= (uint32_t)1 << (i >> 5);
     leave_critical();
 }
 
@@ -91,8 +594,19 @@ void scheduler_add(pcb_t *pcb) {
     }
     
     enter_critical();
-    pcb->status = PROCESS_READY;
-    queue_put(&ready_queue, (node_t *)pcb);
+    sched_enqueue(pcb);
+    check_preempt(pcb);
+    leave_critical();
+}
+
+/* Make a blocked process runnable (semaphore_up, condition_signal, ...) */
+void scheduler_wakeup(pcb_t *pcb) {
+    if (pcb == NULL) {
+        return;
+    }
+    
+    enter_critical();
+    wake_up_process(pcb);
     leave_critical();
 }
 
@@ -102,17 +616,16 @@ void scheduler_entry(void) {
     
     enter_critical();
     
-    /* Get next process from ready queue */
-    next = (pcb_t *)queue_get(&ready_queue);
-    
-    if (next == NULL) {
-        /* No processes ready - idle or halt */
-        /* In a real OS, we might have an idle process */
-        /* For now, we'll just return and let timer interrupt handle it */
+    /* put_current_running() left it running: no reschedule is due */
+    if (current_running != NULL && current_running->status == PROCESS_RUNNING) {
         leave_critical();
         return;
     }
     
+    /* Get next process from this CPU's run queue; if the interrupted
+     * process was queued only to sit out a throttled period, idle */
+    next = pick_next_or_idle(this_cpu());
+    
     /* Set as current running process */
     current_running = next;
     current_running->status = PROCESS_RUNNING;
@@ -121,92 +634,160 @@ void scheduler_entry(void) {
     leave_critical();
 }
 
-/* Put current running process back into ready queue (round-robin) */
+/* Put current running process back into ready queue if a reschedule is due */
 void put_current_running(void) {
     enter_critical();
     
-    if (current_running != NULL && current_running->status == PROCESS_RUNNING) {
-        /* Add current process to end of ready queue (round-robin) */
-        current_running->status = PROCESS_READY;
-        queue_put(&ready_queue, (node_t *)current_running);
+    if (current_running != NULL && current_running->status == PROCESS_RUNNING &&
+        runqueues[pcb_ext(current_running)->cpu].need_resched) {
+        /* Hand it back to its class, which decides where it queues */
+        place_ready(current_running, select_task_rq(current_running), ENQUEUE_PREEMPTED);
     }
     
     leave_critical();
 }
 
-/* Block current process for specified number of milliseconds */
-void do_sleep(uint32_t milliseconds) {
-    uint64_t wakeup_time;
+/* Switch away from the caller at system call exit when a wakeup it
+ * issued (semaphore_up(), condition_signal(), ...) asked for it, rather
+ * than leaving the woken process to wait for the end of the tick */
+void preempt_check_resched(void) {
+    enter_critical();
+    
+    /* Wakeups sync.c queued on the inbox only ask for a reschedule once
+     * they are placed, which would otherwise wait for the next pick */
+    drain_inbox(&runqueues[this_cpu()]);
+    
+    if (current_running != NULL && current_running->status == PROCESS_RUNNING &&
+        runqueues[pcb_ext(current_running)->cpu].need_resched) {
+        put_current_running();
+        scheduler_entry();
+    }
+    
+    leave_critical();
+}
+
+/* Take the caller off the CPU; it is already queued where it waits */
+void scheduler_block(int status) {
     pcb_t *next;
     
     enter_critical();
     
-    if (current_running == NULL) {
-        leave_critical();
-        return;
-    }
+    current_running->status = status;
+    
+    /* Get next process to run, idling until a wakeup brings one */
+    next = pick_next_or_idle(this_cpu());
+    
+    current_running = next;
+    current_running->status = PROCESS_RUNNING;
+    current_running->nested_count = 0;
+    
+    leave_critical();
+    
+    /* Context switch will happen when we return to assembly */
+}
+
+/* Convert milliseconds to timer ticks, rounding up */
+uint32_t ms_to_ticks(uint32_t milliseconds) {
+#if MS_PER_TICK == 10
+    /* milliseconds / 10 as a multiply by ceil(2^35 / 10) and a shift,
+     * exact for every 32-bit input; the remainder decides the round-up */
+    uint32_t ticks = (uint32_t)(((uint64_t)milliseconds * 0xcccccccdu) >> 35);
+    
+    return ticks + (milliseconds - ticks * MS_PER_TICK != 0);
+#else
+    uint32_t ticks = milliseconds / MS_PER_TICK;
     
-    /* Calculate wakeup time (convert milliseconds to timer ticks) */
-    /* Assuming TIMER_HZ = 100 (10ms per tick) */
-    /* milliseconds / MS_PER_TICK = number of ticks */
-    wakeup_time = time_elapsed + (milliseconds / MS_PER_TICK);
     if (milliseconds % MS_PER_TICK != 0) {
-        wakeup_time++; /* Round up */
+        ticks++; /* Round up */
     }
+    return ticks;
+#endif
+}
+
+/* Put a process on the sleep queue until a given tick */
+void sleep_enqueue(pcb_t *pcb, uint64_t wakeup_time) {
+    pcb_ext_t *ext = pcb_ext(pcb);
     
-    /* Store wakeup time in PCB */
-    current_running->wakeup_time = wakeup_time;
-    current_running->status = PROCESS_SLEEPING;
+    pcb->wakeup_time = wakeup_time;
     
-    /* Move current process to sleeping queue */
-    queue_put(&sleeping_queue, (node_t *)current_running);
+    ext->sleep_index = nr_sleepers++;
+    sleep_wake[ext->sleep_index] = (uint32_t)wakeup_time;
+    sleep_slot[ext->sleep_index] = pcb_slot(pcb);
+    
+    /* A stopped tick must still fire for this deadline */
+    if (wakeup_time < nohz_next_event) {
+        nohz_next_event = wakeup_time;
+    }
+}
+
+/* Take a sleeping process off the sleep queue */
+void sleep_dequeue(pcb_t *pcb) {
+    pcb_ext_t *ext = pcb_ext(pcb);
+    int i = ext->sleep_index, last = --nr_sleepers;
     
-    /* Get next process to run */
-    next = (pcb_t *)queue_get(&ready_queue);
+    /* Swap-remove: the last entry fills the hole */
+    if (i != last) {
+        sleep_wake[i] = sleep_wake[last];
+        sleep_slot[i] = sleep_slot[last];
+        pcb_ext_table[sleep_slot[i]].sleep_index = i;
+    }
+    ext->sleep_index = -1;
+}
+
+/* Block current process for specified number of milliseconds */
+void do_sleep(uint32_t milliseconds) {
+    enter_critical();
     
-    if (next != NULL) {
-        current_running = next;
-        current_running->status = PROCESS_RUNNING;
-        current_running->nested_count = 0;
-    } else {
-        /* No ready processes - set current_running to NULL */
-        /* Timer will continue and eventually wake up sleeping processes */
-        current_running = NULL;
+    if (current_running == NULL) {
+        leave_critical();
+        return;
     }
     
-    leave_critical();
+    /* Move current process to sleeping queue */
+    sleep_enqueue(current_running, time_elapsed + ms_to_ticks(milliseconds));
+    scheduler_block(PROCESS_SLEEPING);
     
-    /* Context switch will happen when we return to assembly */
+    leave_critical();
 }
 
 /* Check if any sleeping processes should be awakened */
 void check_sleeping(void) {
+    uint32_t expired[(MAX_PROCESSES + 31) / 32];
     pcb_t *pcb;
-    node_t *node;
-    int count, i;
+    int w, i;
     
     enter_critical();
     
-    /* Get number of sleeping processes */
-    count = queue_size(&sleeping_queue);
+    /* With the tick stopped no deadline is due before nohz_next_event,
+     * on whose tick scheduler_tick() restarts it */
+    if (runqueues[this_cpu()].tick_stopped && time_elapsed < nohz_next_event) {
+        leave_critical();
+        return;
+    }
     
-    /* Check each sleeping process */
-    for (i = 0; i < count; i++) {
-        node = queue_get(&sleeping_queue);
-        if (node == NULL) {
-            break;
-        }
-        
-        pcb = (pcb_t *)node;
-        
-        /* Check if it's time to wake up */
-        if (time_elapsed >= pcb->wakeup_time) {
-            /* Wake up process - add to ready queue */
-            pcb->status = PROCESS_READY;
-            queue_put(&ready_queue, node);
-        } else {
-            /* Not time yet - put back in sleeping queue */
-            queue_put(&sleeping_queue, node);
+    /* One pass over the wakeup table marks every expired sleeper */
+    if (sleep_scan_expired(sleep_wake, nr_sleepers, (uint32_t)time_elapsed, expired) == 0) {
+        leave_critical();
+        return;
+    }
+    
+    /* Highest entries first, so a swap-remove only ever moves an entry
+     * that has already been looked at */
+    for (w = (nr_sleepers + 31) / 32 - 1; w >= 0; w--) {
+        while (expired[w] != 0) {
+            i = (w << 5) + 31 - __builtin_clz(expired[w]);
+            expired[w] &= ~((uint32_t)1 << (i & 31));
+            
+            pcb = process_slot(sleep_slot[i]);
+            sleep_dequeue(pcb);
+            
+            /* A timed do_wait_any() gives up its registrations first */
+            if (pcb_ext(pcb)->wait_nr > 0) {
+                wait_cancel(pcb, WAIT_TIMEOUT);
+            }
+            
+            /* Wake up process - add to an allowed CPU's ready queue */
+            wake_up_process(pcb);
         }
     }
     
@@ -219,20 +800,19 @@ void do_yield(void) {
     
     enter_critical();
     
-    /* Put current process back in ready queue */
+    /* Put current process back in ready queue, as its class sees fit */
     if (current_running != NULL && current_running->status == PROCESS_RUNNING) {
         current_running->status = PROCESS_READY;
-        queue_put(&ready_queue, (node_t *)current_running);
+        sched_call(pcb_ext(current_running)->sched_class, yield)(
+            &runqueues[pcb_ext(current_running)->cpu], current_running);
     }
     
-    /* Get next process */
-    next = (pcb_t *)queue_get(&ready_queue);
+    /* Get next process; a throttled yielder leaves the CPU idle */
+    next = pick_next_or_idle(this_cpu());
     
-    if (next != NULL) {
-        current_running = next;
-        current_running->status = PROCESS_RUNNING;
-        current_running->nested_count = 0;
-    }
+    current_running = next;
+    current_running->status = PROCESS_RUNNING;
+    current_running->nested_count = 0;
     
     leave_critical();
     
@@ -252,16 +832,12 @@ void do_exit(void) {
         /* pcb_free(current_running); */
     }
     
-    /* Get next process */
-    next = (pcb_t *)queue_get(&ready_queue);
+    /* Get next process, idling until there is one */
+    next = pick_next_or_idle(this_cpu());
     
-    if (next != NULL) {
-        current_running = next;
-        current_running->status = PROCESS_RUNNING;
-        current_running->nested_count = 0;
-    } else {
-        current_running = NULL;
-    }
+    current_running = next;
+    current_running->status = PROCESS_RUNNING;
+    current_running->nested_count = 0;
     
     leave_critical();
     
@@ -303,6 +879,194 @@ void do_setpriority(int priority) {
     leave_critical();
 }
 
+/* Set the CPUs a process may run on (pid 0 means the caller) */
+int do_setaffinity(int pid, cpumask_t mask) {
+    pcb_t *pcb;
+    pcb_ext_t *ext;
+    
+    /* Ignore CPUs that do not exist; an empty set is invalid */
+    mask &= CPU_MASK_ALL;
+    if (mask == CPU_MASK_NONE) {
+        return -1;
+    }
+    
+    enter_critical();
+    
+    pcb = (pid == 0) ? current_running : get_process_by_pid(pid);
+    if (pcb == NULL) {
+        leave_critical();
+        return -1;
+    }
+    
+    ext = pcb_ext(pcb);
+    ext->affinity = mask;
+    
+    /* Migrate a queued process off a CPU it is no longer allowed on.
+     * A running one is moved when it is next put back on a queue. */
+    if (pcb->status == PROCESS_READY && !(mask & cpu_mask(ext->cpu))) {
+        sched_dequeue(pcb);
+        sched_enqueue(pcb);
+    }
+    
+    leave_critical();
+    return 0;
+}
+
+/* Get the CPUs a process may run on (pid 0 means the caller) */
+cpumask_t do_getaffinity(int pid) {
+    pcb_t *pcb;
+    cpumask_t mask;
+    
+    enter_critical();
+    
+    pcb = (pid == 0) ? current_running : get_process_by_pid(pid);
+    mask = (pcb != NULL) ? pcb_ext(pcb)->affinity : CPU_MASK_NONE;
+    
+    leave_critical();
+    return mask;
+}
+
+/* Choose the CPUs that stop their tick while running a single process */
+int do_sched_setnohz(cpumask_t mask) {
+    int cpu;
+    
+    if (mask & ~CPU_MASK_ALL) {
+        return -1;
+    }
+    
+    enter_critical();
+    
+    nohz_full_mask = mask;
+    for (cpu = 0; cpu < NR_CPUS; cpu++) {
+        if (!(mask & cpu_mask(cpu))) {
+            tick_nohz_restart(&runqueues[cpu], time_elapsed);
+        }
+    }
+    
+    leave_critical();
+    return 0;
+}
+
+/* Default quantum of a scheduling policy, in ticks */
+static int policy_timeslice(int policy) {
+    switch (policy) {
+    case SCHED_RR:
+        return RT_RR_TIMESLICE;
+    case SCHED_BATCH:
+        return BATCH_TIMESLICE;
+    case SCHED_IDLE:
+        return IDLE_TIMESLICE;
+    default:
+        return 0;
+    }
+}
+
+/* Set the scheduling policy and real-time priority of a process
+ * (pid 0 means the caller); priority must be 0 for SCHED_NORMAL */
+int do_setscheduler(int pid, int policy, int priority) {
+    const sched_class_t *class;
+    pcb_t *pcb;
+    pcb_ext_t *ext;
+    
+    switch (policy) {
+    case SCHED_NORMAL:
+        class = &fair_sched_class;
+        break;
+#if !CONFIG_SCHED_FAIR_ONLY
+    case SCHED_FIFO:
+    case SCHED_RR:
+        if (priority < 0 || priority >= RT_PRIO_LEVELS) {
+            return -1;
+        }
+        class = &rt_sched_class;
+        break;
+    case SCHED_BATCH:
+        class = &batch_sched_class;
+        break;
+    case SCHED_IDLE:
+        class = &idle_sched_class;
+        break;
+#endif
+    default:
+        return -1;
+    }
+    
+    /* Only the real-time policies take a priority */
+    if (policy != SCHED_FIFO && policy != SCHED_RR && priority != 0) {
+        return -1;
+    }
+    
+    enter_critical();
+    
+    pcb = (pid == 0) ? current_running : get_process_by_pid(pid);
+    if (pcb == NULL) {
+        leave_critical();
+        return -1;
+    }
+    
+    ext = pcb_ext(pcb);
+    if (pcb->status == PROCESS_READY) {
+        /* Requeue under the new class and priority */
+        sched_dequeue(pcb);
+        ext->sched_class = class;
+        ext->policy = policy;
+        ext->rt_priority = priority;
+        ext->slice = 0;
+        sched_enqueue(pcb);
+    } else {
+        ext->sched_class = class;
+        ext->policy = policy;
+        ext->rt_priority = priority;
+        ext->slice = policy_timeslice(policy);
+        
+        /* A running process may no longer be the right one to run */
+        if (pcb->status == PROCESS_RUNNING) {
+            runqueues[ext->cpu].need_resched = 1;
+        }
+    }
+    
+    leave_critical();
+    return 0;
+}
+
+/* Get the scheduling policy of a process (pid 0 means the caller) */
+int do_getscheduler(int pid) {
+    pcb_t *pcb;
+    int policy;
+    
+    enter_critical();
+    
+    pcb = (pid == 0) ? current_running : get_process_by_pid(pid);
+    policy = (pcb != NULL) ? pcb_ext(pcb)->policy : -1;
+    
+    leave_critical();
+    return policy;
+}
+
+/* Sum the wakeup placement and migration counters of all CPUs */
+void do_sched_wake_stats(sched_wake_stats_t *stats) {
+    rq_t *rq;
+    int cpu;
+    
+    if (stats == NULL) {
+        return;
+    }
+    
+    enter_critical();
+    
+    memset(stats, 0, sizeof(*stats));
+    for (cpu = 0; cpu < NR_CPUS; cpu++) {
+        rq = &runqueues[cpu];
+        stats->nr_wakeups += rq->nr_wakeups;
+        stats->nr_wake_prev += rq->nr_wake_prev;
+        stats->nr_wake_affine += rq->nr_wake_affine;
+        stats->nr_wake_idle += rq->nr_wake_idle;
+        stats->nr_migrations += rq->nr_migrations;
+    }
+    
+    leave_critical();
+}
+
 /* Get current running process */
 pcb_t* get_current_process(void) {
     return current_running;
@@ -310,16 +1074,19 @@ pcb_t* get_current_process(void) {
 
 /* Get process by PID */
 pcb_t* get_process_by_pid(int pid) {
-    int i;
+    int i = pid & PID_SLOT_MASK;
+    
+    /* The PID names its slot; a stale PID has an older generation */
+    if (pid <= 0 || i >= MAX_PROCESSES) {
+        return NULL;
+    }
     
     enter_critical();
     
-    for (i = 0; i < MAX_PROCESSES; i++) {
-        if (process_table[i].pid == pid && 
-            process_table[i].status != PROCESS_FREE) {
-            leave_critical();
-            return &process_table[i];
-        }
+    if (process_table[i].pid == pid && 
+        process_table[i].status != PROCESS_FREE) {
+        leave_critical();
+        return &process_table[i];
     }
     
     leave_critical();
@@ -328,12 +1095,15 @@ pcb_t* get_process_by_pid(int pid) {
 
 /* Print scheduler statistics (for debugging) */
 void scheduler_print_stats(void) {
-    int ready_count, sleeping_count;
+    int ready_count, sleeping_count, cpu;
     
     enter_critical();
     
-    ready_count = queue_size(&ready_queue);
-    sleeping_count = queue_size(&sleeping_queue);
+    ready_count = 0;
+    for (cpu = 0; cpu < NR_CPUS; cpu++) {
+        ready_count += rq_nr_running(&runqueues[cpu]);
+    }
+    sleeping_count = nr_sleepers;
     
     /* Use printf here if available */
     /* printf("Ready: %d, Sleeping: %d, Current: %d\n", 
@@ -0,0 +1,183 @@
+/* slab.c - Slab allocator with per-CPU magazines */
+
+#include "slab.h"
+#include "sched_ext.h"
+#include "queue.h"
+#include "interrupt.h"
+#include "common.h"
+
+/* Memory all slabs are carved from */
+static uint8_t slab_arena[SLAB_ARENA_PAGES][SLAB_SIZE]
+    __attribute__((aligned(SLAB_SIZE)));
+
+/* Arena pages handed out so far; slabs are never given back */
+static int slab_pages_used;
+
+/* Offset of the first object in a slab, before coloring */
+#define SLAB_HEADER ((sizeof(slab_t) + CACHE_LINE - 1) & ~(CACHE_LINE - 1))
+
+/* Free link kept after the object, so the constructed state survives */
+#define FREE_LINK(cache, obj) (*(void **)((uint8_t *)(obj) + (cache)->stride - sizeof(void *)))
+
+/* Slab holding an object */
+static slab_t* slab_of(void *obj) {
+    return (slab_t *)((unsigned long)obj & ~(unsigned long)(SLAB_SIZE - 1));
+}
+
+/* Set up a cache */
+int kmem_cache_init(kmem_cache_t *cache, const char *name, uint32_t size,
+                    void (*ctor)(void *obj)) {
+    int cpu;
+    
+    cache->name = name;
+    cache->size = size;
+    cache->stride = (size + sizeof(void *) + SLAB_ALIGN - 1) & ~(SLAB_ALIGN - 1);
+    cache->ctor = ctor;
+    
+    if (cache->stride > SLAB_SIZE - SLAB_HEADER) {
+        return -1;
+    }
+    cache->per_slab = (SLAB_SIZE - SLAB_HEADER) / cache->stride;
+    cache->color_max = (SLAB_SIZE - SLAB_HEADER) - cache->per_slab * cache->stride;
+    cache->color_next = 0;
+    
+    queue_init(&cache->partial);
+    queue_init(&cache->full);
+    queue_init(&cache->empty);
+    for (cpu = 0; cpu < NR_CPUS; cpu++) {
+        cache->mag[cpu].nr = 0;
+    }
+    cache->nr_slabs = 0;
+    cache->nr_active = 0;
+    
+    return 0;
+}
+
+/* Carve a new slab for a cache and construct its objects */
+static slab_t* slab_grow(kmem_cache_t *cache) {
+    slab_t *slab;
+    uint8_t *obj;
+    int i;
+    
+    if (slab_pages_used >= SLAB_ARENA_PAGES) {
+        return NULL;
+    }
+    slab = (slab_t *)slab_arena[slab_pages_used++];
+    
+    slab->node.prev = NULL;
+    slab->node.next = NULL;
+    slab->free = NULL;
+    slab->inuse = 0;
+    
+    /* Color: start each new slab one cache line further in */
+    obj = (uint8_t *)slab + SLAB_HEADER + cache->color_next;
+    cache->color_next += CACHE_LINE;
+    if (cache->color_next > cache->color_max) {
+        cache->color_next = 0;
+    }
+    
+    /* Build the free list back to front, so objects go out in order */
+    obj += (cache->per_slab - 1) * cache->stride;
+    for (i = 0; i < cache->per_slab; i++, obj -= cache->stride) {
+        if (cache->ctor != NULL) {
+            cache->ctor(obj);
+        }
+        FREE_LINK(cache, obj) = slab->free;
+        slab->free = obj;
+    }
+    
+    cache->nr_slabs++;
+    queue_put(&cache->empty, &slab->node);
+    return slab;
+}
+
+/* Take an object from the slab lists */
+static void* slab_alloc(kmem_cache_t *cache) {
+    slab_t *slab;
+    void *obj;
+    
+    slab = (slab_t *)queue_peek(&cache->partial);
+    if (slab == NULL) {
+        slab = (slab_t *)queue_peek(&cache->empty);
+        if (slab == NULL && (slab = slab_grow(cache)) == NULL) {
+            return NULL;
+        }
+        queue_unlink(&cache->empty, &slab->node);
+        queue_put(&cache->partial, &slab->node);
+    }
+    
+    obj = slab->free;
+    slab->free = FREE_LINK(cache, obj);
+    slab->inuse++;
+    if (slab->free == NULL) {
+        queue_unlink(&cache->partial, &slab->node);
+        queue_put(&cache->full, &slab->node);
+    }
+    
+    return obj;
+}
+
+/* Put an object back on its slab */
+static void slab_free(kmem_cache_t *cache, void *obj) {
+    slab_t *slab = slab_of(obj);
+    
+    if (slab->free == NULL) {
+        queue_unlink(&cache->full, &slab->node);
+        queue_put(&cache->partial, &slab->node);
+    }
+    
+    FREE_LINK(cache, obj) = slab->free;
+    slab->free = obj;
+    if (--slab->inuse == 0) {
+        queue_unlink(&cache->partial, &slab->node);
+        queue_put(&cache->empty, &slab->node);
+    }
+}
+
+/* Take a constructed object from a cache */
+void* kmem_cache_alloc(kmem_cache_t *cache) {
+    magazine_t *mag;
+    void *obj;
+    
+    enter_critical();
+    
+    /* Refill an empty magazine with half a load from the slabs */
+    mag = &cache->mag[this_cpu()];
+    if (mag->nr == 0) {
+        while (mag->nr < MAG_SIZE / 2 && (obj = slab_alloc(cache)) != NULL) {
+            mag->objs[mag->nr++] = obj;
+        }
+    }
+    
+    obj = NULL;
+    if (mag->nr > 0) {
+        obj = mag->objs[--mag->nr];
+        cache->nr_active++;
+    }
+    
+    leave_critical();
+    return obj;
+}
+
+/* Return an object to its cache */
+void kmem_cache_free(kmem_cache_t *cache, void *obj) {
+    magazine_t *mag;
+    
+    if (obj == NULL) {
+        return;
+    }
+    
+    enter_critical();
+    
+    /* A full magazine gives half back to the slabs */
+    mag = &cache->mag[this_cpu()];
+    if (mag->nr == MAG_SIZE) {
+        while (mag->nr > MAG_SIZE / 2) {
+            slab_free(cache, mag->objs[--mag->nr]);
+        }
+    }
+    mag->objs[mag->nr++] = obj;
+    cache->nr_active--;
+    
+    leave_critical();
+}
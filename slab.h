@@ -0,0 +1,106 @@
+/* slab.h - Object caches for fixed-size kernel objects */
+
+#ifndef SLAB_H
+#define SLAB_H
+
+#include "sched_ext.h"
+#include "queue.h"
+#include "common.h"
+
+#define SLAB_SIZE               4096    /* Bytes per slab, also its alignment */
+#define SLAB_ARENA_PAGES        64      /* Slabs available to all caches */
+#define SLAB_ALIGN              8       /* Object alignment */
+#define CACHE_LINE              64      /* Coloring step */
+#define MAG_SIZE                16      /* Objects held per CPU magazine */
+
+/**
+ * struct slab - Header at the start of every slab page
+ * @node: Link in its cache's partial, full or empty list
+ * @free: Free objects, linked through the word after each object
+ * @inuse: Objects handed out from this slab
+ *
+ * The slab of an object is found by rounding its address down to
+ * SLAB_SIZE, so freeing needs no lookup.
+ */
+typedef struct slab {
+    node_t node;
+    void *free;
+    int inuse;
+} slab_t;
+
+/**
+ * struct magazine - Per-CPU stack of free objects
+ * @nr: Objects on the stack
+ * @objs: The objects, most recently freed last
+ */
+typedef struct magazine {
+    int nr;
+    void *objs[MAG_SIZE];
+} magazine_t;
+
+/**
+ * struct kmem_cache - Cache of constructed objects of one size
+ * @name: Name for statistics
+ * @size: Object size as requested
+ * @stride: Distance between objects (object, free link, alignment)
+ * @ctor: Called once per object when its slab is created, may be NULL
+ * @per_slab: Objects per slab
+ * @color_max: Bytes a slab has to spare for coloring
+ * @color_next: Offset the next new slab starts its objects at
+ * @partial: Slabs with both free and used objects
+ * @full: Slabs with no free object
+ * @empty: Slabs with no used object, kept for reuse
+ * @mag: Per-CPU magazines, tried before the slab lists
+ * @nr_slabs: Slabs owned by the cache
+ * @nr_active: Objects handed out (nr_slabs * per_slab - nr_active are
+ *             idle, a measure of fragmentation)
+ *
+ * Objects go back to the cache in their constructed state, so the
+ * constructor's work is not repeated on every allocation. Successive
+ * slabs offset their objects by one more CACHE_LINE, so hot fields of
+ * objects in different slabs do not all fall in the same cache sets.
+ */
+typedef struct kmem_cache {
+    const char *name;
+    uint32_t size;
+    uint32_t stride;
+    void (*ctor)(void *obj);
+    int per_slab;
+    uint32_t color_max;
+    uint32_t color_next;
+    queue_t partial;
+    queue_t full;
+    queue_t empty;
+    magazine_t mag[NR_CPUS];
+    uint32_t nr_slabs;
+    uint32_t nr_active;
+} kmem_cache_t;
+
+/**
+ * kmem_cache_init - Set up a cache
+ * @cache: Cache to set up
+ * @name: Name for statistics
+ * @size: Object size in bytes
+ * @ctor: Object constructor, or NULL
+ *
+ * Return: 0 on success, -1 if @size does not fit in a slab
+ */
+int kmem_cache_init(kmem_cache_t *cache, const char *name, uint32_t size,
+                    void (*ctor)(void *obj));
+
+/**
+ * kmem_cache_alloc - Take a constructed object from a cache
+ * @cache: Cache to allocate from
+ *
+ * Return: Pointer to the object, or NULL if the slab arena is exhausted
+ */
+void *kmem_cache_alloc(kmem_cache_t *cache);
+
+/**
+ * kmem_cache_free - Return an object to its cache
+ * @cache: Cache it came from
+ * @obj: Object, back in its constructed state
+ */
+void kmem_cache_free(kmem_cache_t *cache, void *obj);
+
+#endif /* SLAB_H */
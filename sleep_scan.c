@@ -0,0 +1,80 @@
+/* sleep_scan.c - Expiry scan over the dense sleeper wakeup table */
+
+#include "sched_ext.h"
+#include "common.h"
+
+/*
+ * The vector kernels are only built when the kernel itself is compiled
+ * with -msse2 or -mavx2, which also requires the entry code to save the
+ * interrupted process's XMM/YMM state. Otherwise the scalar loop is used.
+ * GCC vector types stand in for the intrinsics headers, which drag in
+ * the C library.
+ */
+#if defined(__AVX2__)
+typedef int v8si __attribute__((vector_size(32), aligned(4)));
+typedef float v8sf __attribute__((vector_size(32)));
+#elif defined(__SSE2__)
+typedef int v4si __attribute__((vector_size(16), aligned(4)));
+typedef float v4sf __attribute__((vector_size(16)));
+#endif
+
+/* Bits set in x; __builtin_popcount() is a libgcc call without -mpopcnt */
+static inline int popcount32(uint32_t x) {
+    x = x - ((x >> 1) & 0x55555555);
+    x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+    x = (x + (x >> 4)) & 0x0f0f0f0f;
+    return (int)((x * 0x01010101) >> 24);
+}
+
+/* Set bit i of mask for every entry with (int32_t)(now - wake[i]) >= 0 */
+int sleep_scan_expired(const uint32_t *wake, int n, uint32_t now, uint32_t *mask) {
+    int w, i = 0, expired = 0;
+    
+    for (w = 0; w < (n + 31) / 32; w++) {
+        mask[w] = 0;
+    }
+    
+#if defined(__AVX2__)
+    {
+        v8si nowv = { (int)now, (int)now, (int)now, (int)now,
+                      (int)now, (int)now, (int)now, (int)now };
+        v8si diff;
+        uint32_t bits;
+        
+        /* now - wake has its sign bit clear for every expired entry */
+        for (; i + 8 <= n; i += 8) {
+            diff = nowv - *(const v8si *)&wake[i];
+            bits = ~(uint32_t)__builtin_ia32_movmskps256((v8sf)diff) & 0xff;
+            mask[i >> 5] |= bits << (i & 31);
+        }
+    }
+#elif defined(__SSE2__)
+    {
+        v4si nowv = { (int)now, (int)now, (int)now, (int)now };
+        v4si diff;
+        uint32_t bits;
+        
+        /* now - wake has its sign bit clear for every expired entry */
+        for (; i + 4 <= n; i += 4) {
+            diff = nowv - *(const v4si *)&wake[i];
+            bits = ~(uint32_t)__builtin_ia32_movmskps((v4sf)diff) & 0xf;
+            mask[i >> 5] |= bits << (i & 31);
+        }
+    }
+#endif
+    
+    /* Count what the vector loop set once per mask word, not per vector */
+    for (w = 0; w < (i + 31) / 32; w++) {
+        expired += popcount32(mask[w]);
+    }
+    
+    /* Scalar tail (the whole table without vector support) */
+    for (; i < n; i++) {
+        if ((int32_t)(now - wake[i]) >= 0) {
+            mask[i >> 5] |= (uint32_t)1 << (i & 31);
+            expired++;
+        }
+    }
+    
+    return expired;
+}
@@ -12,6 +12,84 @@ void sys_sleep(uint32_t milliseconds);
 int sys_getpriority(void);
 void sys_setpriority(int priority);
 
+/* Scheduling policy: 0 = SCHED_NORMAL, 1 = SCHED_FIFO, 2 = SCHED_RR,
+ * 3 = SCHED_BATCH, 5 = SCHED_IDLE. Real-time priorities are 0..99
+ * (99 highest); the other policies take 0. */
+int sys_setscheduler(int pid, int policy, int priority);
+int sys_getscheduler(int pid);
+
+/* CPU affinity (pid 0 means the caller, bit n of mask is CPU n) */
+int sys_setaffinity(int pid, uint32_t mask);
+uint32_t sys_getaffinity(int pid);
+
+/* Nohz-full: CPUs in mask skip the scheduler tick while they run a
+ * single runnable process (returns -1 for CPUs that do not exist) */
+int sys_sched_setnohz(uint32_t mask);
+
+/* Thread groups (weight is the group's relative CPU share, default 1024) */
+int sys_group_create(int weight);
+int sys_group_destroy(int gid);
+int sys_group_setweight(int gid, int weight);
+int sys_group_move(int pid, int gid);
+
+/* Group bandwidth: at most quota ticks per period ticks (quota 0 = no cap) */
+int sys_group_setquota(int gid, int quota, int period);
+int sys_group_throttled_time(int gid, uint64_t *ticks);
+
+/* Fair time slice: target latency in ticks shared by all runnable
+ * processes, 0 for the fixed one-tick quantum */
+int sys_sched_setlatency(int ticks);
+int sys_sched_getlatency(void);
+
+/* Gang scheduling: members (e.g. all threads of one barrier) run together */
+int sys_gang_create(void);
+int sys_gang_destroy(int gang);
+int sys_gang_join(int pid, int gang);   /* gang -1 leaves the current gang */
+
+/* Wakeup placement and migration counters (fills a sched_wake_stats_t) */
+void sys_sched_wake_stats(void *stats);
+
+/* Idle state usage and predicted vs actual idle lengths in TSC cycles
+ * (fills an idle_stats_t) */
+void sys_sched_idle_stats(void *stats);
+
+/* Event counters (event.h): the event lives in memory shared by its
+ * threads, which update the count directly. sys_event_init() creates the
+ * kernel object its readers block on (released with sys_handle_close());
+ * event_signal() calls sys_event_wake() only when a reader is blocked. */
+int sys_event_init(void *ev);
+int sys_event_wake(int handle);
+
+/* Countdown latches and completions (latch.h), shared like events: only
+ * the last arrival and blocked waiters enter the kernel */
+int sys_latch_init(void *latch, int count);
+int sys_latch_wake(int handle);
+
+/* Kernel-held objects named by handle: type 1 = event, 2 = latch (arg is
+ * the count), 3 = completion, 4 = semaphore (arg is the count), 5 = lock,
+ * any of them ORed with 0x100 to wake waiters highest priority first
+ * instead of FIFO. Signalling adds one to an event, counts a latch down,
+ * and adds a unit to a semaphore or releases a lock (-1 unless the
+ * caller holds it); reading drains an event or returns a latch's or semaphore's
+ * count. Neither works on the handle of a shared-memory event or latch.
+ * A wait on a semaphore or lock takes a unit, so each signal lets exactly
+ * one waiter through, and with 0x100 the highest priority one.
+ *
+ * sys_handle_wait_any() waits on several objects at once: it returns the
+ * index of one that was already signalled, WAIT_TIMEOUT (-2) if none was
+ * and timeout is 0, -1 on error, or WAIT_BLOCKED (-3) if the caller had
+ * to block. timeout -1 waits forever, 0 only polls. */
+int sys_handle_create(int type, int arg);
+int sys_handle_close(int handle);
+int sys_handle_signal(int handle);
+int sys_handle_read(int handle, uint64_t *value);
+int sys_handle_wait_any(int handles[], int n, int timeout);
+
+/* Outcome of the caller's last wait that returned WAIT_BLOCKED: the
+ * index of the object that fired, WAIT_TIMEOUT (-2) after timeout
+ * milliseconds, or -1 if an object was destroyed */
+int sys_wait_result(void);
+
 /* Thread management */
 int sys_create_thread(void (*entry)(void), int priority);
 
@@ -0,0 +1,218 @@
+/* wait.c - Waiting on one or several waitable objects */
+
+#include "scheduler.h"
+#include "sched_ext.h"
+#include "wait.h"
+#include "iqueue.h"
+#include "interrupt.h"
+#include "common.h"
+
+/* External declarations from entry.S */
+extern uint64_t time_elapsed;
+
+/* Registrations owned by each process slot: slot s owns entries
+ * s * WAIT_ANY_MAX onwards, and their queue links are in wait_links */
+static wait_reg_t wait_regs[MAX_PROCESSES * WAIT_ANY_MAX];
+static ilink_t wait_links[MAX_PROCESSES * WAIT_ANY_MAX];
+
+#if MAX_PROCESSES * WAIT_ANY_MAX >= IQ_NONE
+#error "Too many wait registrations for 16-bit queue links"
+#endif
+
+/* Set up the waitable header of an object */
+void waitable_init(waitable_t *obj, int (*try_wait)(waitable_t *obj, pcb_t *pcb)) {
+    iqueue_init(&obj->waiters);
+    obj->try_wait = try_wait;
+    obj->prio = NULL;
+}
+
+/* Switch an object without waiters between FIFO and priority order */
+int waitable_set_prio(waitable_t *obj, wait_prio_t *prio) {
+    int w;
+    
+    enter_critical();
+    
+    if (!iqueue_empty(&obj->waiters)) {
+        leave_critical();
+        return -1;
+    }
+    if (prio != NULL) {
+        for (w = 0; w < WAIT_PRIO_WORDS; w++) {
+            prio->bitmap[w] = 0;
+        }
+    }
+    obj->prio = prio;
+    
+    leave_critical();
+    return 0;
+}
+
+/* Queue registration r of a process on an object: at the tail, or with
+ * a wait_prio behind the last waiter of the same or a higher level */
+static void wait_enqueue(waitable_t *obj, int r, pcb_t *pcb) {
+    wait_prio_t *wp = obj->prio;
+    int level, above;
+    
+    if (wp == NULL) {
+        iqueue_put(&obj->waiters, wait_links, r);
+        return;
+    }
+    
+    level = (pcb_ext(pcb)->policy == SCHED_FIFO || pcb_ext(pcb)->policy == SCHED_RR) ?
+            PRIO_LEVELS + pcb_ext(pcb)->rt_priority : pcb->priority - MIN_PRIORITY;
+    wait_regs[r].level = level;
+    
+    if (wp->bitmap[level >> 5] & ((uint32_t)1 << (level & 31))) {
+        iqueue_insert_after(&obj->waiters, wait_links, wp->last[level], r);
+    } else {
+        above = prio_bitmap_next_above(wp->bitmap, WAIT_PRIO_WORDS, level);
+        iqueue_insert_after(&obj->waiters, wait_links,
+                            above >= 0 ? wp->last[above] : IQ_NONE, r);
+        prio_bitmap_set(wp->bitmap, level);
+    }
+    wp->last[level] = r;
+}
+
+/* Take registration r off its object's queue */
+static void wait_dequeue(waitable_t *obj, int r) {
+    wait_prio_t *wp = obj->prio;
+    int level, prev;
+    
+    /* The level's last waiter hands its place to the one before it */
+    if (wp != NULL && wp->last[wait_regs[r].level] == r) {
+        level = wait_regs[r].level;
+        prev = wait_links[r].prev;
+        if (prev != IQ_NONE && wait_regs[prev].level == level) {
+            wp->last[level] = prev;
+        } else {
+            prio_bitmap_clear(wp->bitmap, level);
+        }
+    }
+    
+    iqueue_unlink(&obj->waiters, wait_links, r);
+}
+
+/* Drop every registration of a waiting process */
+void wait_cancel(pcb_t *pcb, int result) {
+    pcb_ext_t *ext = pcb_ext(pcb);
+    int i, first = pcb_slot(pcb) * WAIT_ANY_MAX;
+    
+    enter_critical();
+    
+    for (i = first; i < first + ext->wait_nr; i++) {
+        wait_dequeue(wait_regs[i].obj, i);
+    }
+    ext->wait_nr = 0;
+    ext->wait_result = result;
+    
+    leave_critical();
+}
+
+/* End a waiter's do_wait_any() with the given result and run it */
+static void wait_complete(pcb_t *pcb, int result) {
+    wait_cancel(pcb, result);
+    
+    /* A timed waiter is also on the sleep queue */
+    if (pcb_ext(pcb)->sleep_index >= 0) {
+        sleep_dequeue(pcb);
+    }
+    scheduler_wakeup(pcb);
+}
+
+/* Hand an object's signal to its waiters, oldest (or highest priority) first */
+int waitable_wake(waitable_t *obj) {
+    wait_reg_t *reg;
+    int woken = 0;
+    
+    enter_critical();
+    
+    while (!iqueue_empty(&obj->waiters)) {
+        reg = &wait_regs[obj->waiters.head];
+        if (!obj->try_wait(obj, reg->pcb)) {
+            break;
+        }
+        wait_complete(reg->pcb, reg->index);
+        woken++;
+    }
+    
+    leave_critical();
+    return woken;
+}
+
+/* Wake every waiter of an object that is going away */
+void waitable_abort(waitable_t *obj) {
+    wait_reg_t *reg;
+    
+    enter_critical();
+    
+    while (!iqueue_empty(&obj->waiters)) {
+        reg = &wait_regs[obj->waiters.head];
+        wait_complete(reg->pcb, WAIT_ERROR);
+    }
+    
+    leave_critical();
+}
+
+/* Block until one of several objects is signalled */
+int do_wait_any(waitable_t *objects[], int n, int timeout) {
+    pcb_ext_t *ext;
+    int i, first;
+    
+    if (objects == NULL || n < 1 || n > WAIT_ANY_MAX || timeout < WAIT_INFINITE) {
+        return WAIT_ERROR;
+    }
+    
+    enter_critical();
+    
+    if (current_running == NULL) {
+        leave_critical();
+        return WAIT_ERROR;
+    }
+    ext = pcb_ext(current_running);
+    
+    /* Something already signalled: take it without blocking */
+    for (i = 0; i < n; i++) {
+        if (objects[i]->try_wait(objects[i], current_running)) {
+            ext->wait_result = i;
+            leave_critical();
+            return i;
+        }
+    }
+    
+    if (timeout == 0) {
+        ext->wait_result = WAIT_TIMEOUT;
+        leave_critical();
+        return WAIT_TIMEOUT;
+    }
+    
+    /* Queue one registration per object; whichever fires first wins */
+    first = pcb_slot(current_running) * WAIT_ANY_MAX;
+    for (i = 0; i < n; i++) {
+        wait_regs[first + i].obj = objects[i];
+        wait_regs[first + i].pcb = current_running;
+        wait_regs[first + i].index = i;
+        wait_enqueue(objects[i], first + i, current_running);
+    }
+    ext->wait_nr = n;
+    ext->wait_result = WAIT_TIMEOUT;
+    
+    if (timeout == WAIT_INFINITE) {
+        scheduler_block(PROCESS_BLOCKED);
+    } else {
+        sleep_enqueue(current_running, time_elapsed + ms_to_ticks(timeout));
+        scheduler_block(PROCESS_SLEEPING);
+    }
+    
+    /* The caller is switched out on the way back to assembly; only
+     * do_wait_result() can tell it what woke it */
+    leave_critical();
+    return WAIT_BLOCKED;
+}
+
+/* Outcome of the caller's last do_wait_any() */
+int do_wait_result(void) {
+    if (current_running == NULL) {
+        return WAIT_ERROR;
+    }
+    return pcb_ext(current_running)->wait_result;
+}
@@ -0,0 +1,146 @@
+/* wait.h - Waitable kernel objects and multi-object waits */
+
+#ifndef WAIT_H
+#define WAIT_H
+
+#include "scheduler.h"
+#include "sched_ext.h"
+#include "iqueue.h"
+#include "common.h"
+
+#define WAIT_ANY_MAX            8       /* Objects one do_wait_any() call may name */
+#define WAIT_INFINITE           (-1)    /* timeout meaning no timeout */
+#define WAIT_ERROR              (-1)    /* Bad arguments */
+#define WAIT_TIMEOUT            (-2)    /* Nothing fired before the timeout */
+#define WAIT_BLOCKED            (-3)    /* Caller blocked: see do_wait_result() */
+
+/* Waiter levels: the fair priorities, then the real-time ones above them */
+#define WAIT_PRIO_LEVELS        (PRIO_LEVELS + RT_PRIO_LEVELS)
+#define WAIT_PRIO_WORDS         ((WAIT_PRIO_LEVELS + 31) / 32)
+
+/**
+ * struct wait_prio - Priority order for the waiters of one object
+ * @last: Last registration queued at each level, valid while its bit is set
+ * @bitmap: Bit l set while a waiter of level l is queued
+ *
+ * The waiters stay on one list, kept highest level first and FIFO within
+ * a level: a new waiter goes right behind the last one of its level, or
+ * of the nearest level above, which the bitmap finds in a word scan. The
+ * waiter woken next is then still the head. A waiter's level is its
+ * pcb->priority when it blocks, or PRIO_LEVELS plus its rt_priority for
+ * a real-time process, so real-time waiters rank above every fair one
+ * and among themselves as the rt class runs them.
+ */
+typedef struct wait_prio {
+    uint16_t last[WAIT_PRIO_LEVELS];
+    uint32_t bitmap[WAIT_PRIO_WORDS];
+} wait_prio_t;
+
+/**
+ * struct waitable - Header of every object do_wait_any() can wait on
+ * @waiters: Registrations (indices into the wait_reg_t table) of the
+ *           blocked processes, FIFO unless @prio is set; @waiters.size
+ *           counts them
+ * @try_wait: Consume the object's signal for @pcb, the waiter it goes
+ *            to, if it has one; returns nonzero on success. Called in a
+ *            critical section.
+ * @prio: Priority order for @waiters, or NULL for FIFO
+ *
+ * An object embeds this as its first member and calls waitable_wake()
+ * whenever it may have become signalled.
+ */
+typedef struct waitable {
+    iqueue_t waiters;
+    int (*try_wait)(struct waitable *obj, pcb_t *pcb);
+    wait_prio_t *prio;
+} waitable_t;
+
+/**
+ * struct wait_reg - One process waiting on one object
+ * @obj: Object waited on
+ * @pcb: Waiting process
+ * @index: Position of @obj in the waiter's objects[] argument
+ * @level: Priority level it is queued at, when @obj has a wait_prio
+ *
+ * Each process owns WAIT_ANY_MAX registrations, so a waiter is on every
+ * object's queue at once and any of them can be unlinked in O(1). The
+ * queue links are kept in a separate ilink_t table.
+ */
+typedef struct wait_reg {
+    waitable_t *obj;
+    pcb_t *pcb;
+    int index;
+    int level;
+} wait_reg_t;
+
+/**
+ * waitable_init - Set up the waitable header of an object
+ * @obj: Object header
+ * @try_wait: The object's consume operation
+ */
+void waitable_init(waitable_t *obj, int (*try_wait)(waitable_t *obj, pcb_t *pcb));
+
+/**
+ * waitable_set_prio - Wake an object's waiters highest priority first
+ * @obj: Object header, with no waiters
+ * @prio: Ordering state, owned by the object until it is destroyed,
+ *        or NULL to go back to FIFO order
+ *
+ * Return: 0 on success, -1 if processes are already waiting on @obj
+ */
+int waitable_set_prio(waitable_t *obj, wait_prio_t *prio);
+
+/**
+ * waitable_wake - Hand an object's signal to its waiters
+ * @obj: Object that may have become signalled
+ *
+ * Wakes waiters in FIFO order, or highest priority first with a
+ * wait_prio, for as long as @obj->try_wait() succeeds, so a single
+ * signal wakes one waiter and a broadcast-style object wakes them all. Each woken waiter is dropped from its other objects.
+ *
+ * Return: Number of processes woken
+ */
+int waitable_wake(waitable_t *obj);
+
+/**
+ * waitable_abort - Wake every waiter of an object that is going away
+ * @obj: Object being destroyed
+ *
+ * The waiters' do_wait_any() reports WAIT_ERROR.
+ */
+void waitable_abort(waitable_t *obj);
+
+/**
+ * wait_cancel - Drop every registration of a waiting process
+ * @pcb: Process blocked in do_wait_any()
+ * @result: Value its do_wait_any() reports (e.g. WAIT_TIMEOUT)
+ *
+ * Does not make the process runnable; check_sleeping() does that.
+ */
+void wait_cancel(pcb_t *pcb, int result);
+
+/**
+ * do_wait_any - Block until one of several objects is signalled
+ * @objects: Objects to wait on
+ * @n: Number of objects, 1..WAIT_ANY_MAX
+ * @timeout: Milliseconds to wait, WAIT_INFINITE, or 0 to poll
+ *
+ * The first object found signalled is consumed and the others are left
+ * alone. A caller that has to block switches away before its outcome is
+ * known, and the system call returns what it returned then; it gets
+ * WAIT_BLOCKED, and the outcome, stored in pcb_ext()->wait_result, from
+ * do_wait_result() once it runs again.
+ *
+ * Return: Index of the signalled object, WAIT_TIMEOUT or WAIT_ERROR
+ * without blocking, WAIT_BLOCKED otherwise
+ */
+int do_wait_any(waitable_t *objects[], int n, int timeout);
+
+/**
+ * do_wait_result - Outcome of the caller's last do_wait_any()
+ *
+ * Return: Index of the object that fired, WAIT_TIMEOUT or WAIT_ERROR
+ */
+int do_wait_result(void);
+
+#endif /* WAIT_H */